@@ -1,6 +1,6 @@
 #include <string.h>
 
-#include <a2blocked.h>
+#include "a2blocked.h"
 #include "uarray2b.h"
 
 // define a private version of each function in A2Methods_T that we implement
@@ -51,6 +51,19 @@ static void map_block_major(A2 array2, A2Methods_applyfun apply, void *cl)
         UArray2b_map(array2, (applyfun *) apply, cl);
 }
 
+static void map_hilbert(A2 array2, A2Methods_applyfun apply, void *cl)
+{
+        UArray2b_map_hilbert(array2, (applyfun *) apply, cl);
+}
+
+typedef void spanfun(int i, int j, int len, UArray2b_T array2b, void *span,
+                     void *cl);
+
+static void map_spans(A2 array2, A2Methods_spanfun apply, void *cl)
+{
+        UArray2b_map_spans(array2, (spanfun *) apply, cl);
+}
+
 struct small_closure {
         A2Methods_smallapplyfun *apply;
         void *cl;
@@ -89,6 +102,8 @@ static struct A2Methods_T uarray2_methods_blocked_struct = {
         NULL,                   // small_map_col_major
         small_map_block_major,
         small_map_block_major,  // small_map_default
+        map_hilbert,            // blocks in Hilbert order
+        map_spans,              // one span per block row
 };
 
 // finally the payoff: here is the exported pointer to the struct
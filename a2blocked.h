@@ -0,0 +1,9 @@
+#ifndef A2BLOCKED_INCLUDED
+#define A2BLOCKED_INCLUDED
+
+#include "a2methods.h"
+
+/* blocked UArray2b arrays, mapped in block-major order */
+extern A2Methods_T uarray2_methods_blocked;
+
+#endif
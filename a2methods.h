@@ -0,0 +1,86 @@
+#ifndef A2METHODS_INCLUDED
+#define A2METHODS_INCLUDED
+
+/*
+ * This is the course's A2Methods interface, extended for this program.
+ * New entries are only ever added at the end of struct A2Methods_T, so
+ * code compiled against the original interface (e.g. Pnm_ppmread) sees
+ * the same layout for the entries it knows about.
+ */
+
+typedef void *A2Methods_UArray2;    /* completely unsafe */
+typedef void A2Methods_Object;      /* a cell of an A2Methods_UArray2 */
+
+/* apply function suitable for mapping */
+typedef void A2Methods_applyfun(int i, int j, A2Methods_UArray2 array2, 
+                                A2Methods_Object *ptr, void *cl);
+
+typedef void A2Methods_mapfun(A2Methods_UArray2 array2, 
+                              A2Methods_applyfun apply, void *cl);
+
+/* apply function for small mapping */
+typedef void A2Methods_smallapplyfun(A2Methods_Object *ptr, void *cl);
+
+typedef void A2Methods_smallmapfun(A2Methods_UArray2 a2, 
+                                   A2Methods_smallapplyfun f, void *cl);
+
+/* apply function for span mapping: 'span' points at 'len' cells that are
+   contiguous in memory, holding columns i .. i + len - 1 of row j */
+typedef void A2Methods_spanfun(int i, int j, int len, A2Methods_UArray2 array2,
+                               A2Methods_Object *span, void *cl);
+
+typedef void A2Methods_spanmapfun(A2Methods_UArray2 array2,
+                                  A2Methods_spanfun apply, void *cl);
+
+/*
+ * An A2Methods_T is a pointer to a struct full of function pointers.
+ * Each 2D-array representation provides one such struct; the map
+ * functions that do not make sense for a representation are NULL.
+ */
+typedef struct A2Methods_T {
+        /* creates a distinct 2D array of memory cells, each of the given
+           'size'; every cell's contents are zero */
+        A2Methods_UArray2 (*new)(int width, int height, int size);
+
+        /* creates a distinct 2D array of memory cells, each of the given
+           'size'; blocksize is a hint that blocked arrays use */
+        A2Methods_UArray2 (*new_with_blocksize)(int width, int height,
+                                                int size, int blocksize);
+
+        /* frees *array2p and overwrites the pointer with NULL */
+        void (*free)(A2Methods_UArray2 *array2p);
+
+        /* observe properties of the array */
+        int (*width)    (A2Methods_UArray2 array2);
+        int (*height)   (A2Methods_UArray2 array2);
+        int (*size)     (A2Methods_UArray2 array2);
+        int (*blocksize)(A2Methods_UArray2 array2);  /* -1 if unblocked */
+
+        /* returns a pointer to the object in column i, row j
+           (checked runtime error if i or j is out of bounds) */
+        A2Methods_Object *(*at)(A2Methods_UArray2 array2, int i, int j);
+
+        /* mapping functions */
+        A2Methods_mapfun *map_row_major;
+        A2Methods_mapfun *map_col_major;
+        A2Methods_mapfun *map_block_major;
+        A2Methods_mapfun *map_default; /* whatever is fastest */
+
+        A2Methods_smallmapfun *small_map_row_major;
+        A2Methods_smallmapfun *small_map_col_major;
+        A2Methods_smallmapfun *small_map_block_major;
+        A2Methods_smallmapfun *small_map_default;
+
+        /* ---- extensions to the course interface ---- */
+
+        /* visits the cells (UArray2, UArray2m) or the blocks (UArray2b,
+           cells of a block in row-major order) along a Hilbert curve */
+        A2Methods_mapfun *map_hilbert;
+
+        /* visits every cell exactly once, as runs of cells that are
+           contiguous in memory and lie in one row, in the same order as
+           map_default: whole rows of a UArray2, block rows of a UArray2b */
+        A2Methods_spanmapfun *map_spans;
+} *A2Methods_T;
+
+#endif
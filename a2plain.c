@@ -15,7 +15,7 @@
  **************************************************************/
 
 #include <string.h>
-#include <a2plain.h>
+#include "a2plain.h"
 #include <assert.h>
 
 #include "uarray2.h"
@@ -241,6 +241,55 @@ static void map_col_major(A2Methods_UArray2 uarray2,
         UArray2_map_col_major(uarray2, (UArray2_applyfun*)apply, cl);
 }
 
+/*************** map_hilbert ***************
+ * 
+ * Maps through the given A2Methods_UArray2 along a Hilbert curve and
+ * executes the given apply function on every element, storing data in the
+ * void pointer closure.
+ *
+ * Parameters:
+ *      A2Methods_UArray2 uarray2: an A2Methods_UArray2 object
+ *      A2Methods_applyfun apply:  apply function used for the mapping
+ *      void *cl:                  void pointer to a closure where data will be
+ *                                 stored throughout mapping
+ * Returns:
+ *      None
+ * Expects:
+ *      uarray2 does not equal NULL (throws a CRE otherwise)
+ *
+ ***************************************/
+static void map_hilbert(A2Methods_UArray2 uarray2,
+                        A2Methods_applyfun apply,
+                        void *cl)
+{
+        assert(uarray2 != NULL);
+        UArray2_map_hilbert(uarray2, (UArray2_applyfun*)apply, cl);
+}
+
+/*************** map_spans ***************
+ * 
+ * Maps through the given A2Methods_UArray2 one row at a time, passing each
+ * row to apply as a single span of contiguous cells.
+ *
+ * Parameters:
+ *      A2Methods_UArray2 uarray2: an A2Methods_UArray2 object
+ *      A2Methods_spanfun apply:   function executed on every row
+ *      void *cl:                  void pointer to a closure where data will be
+ *                                 stored throughout mapping
+ * Returns:
+ *      None
+ * Expects:
+ *      uarray2 does not equal NULL (throws a CRE otherwise)
+ *
+ ***************************************/
+static void map_spans(A2Methods_UArray2 uarray2,
+                      A2Methods_spanfun apply,
+                      void *cl)
+{
+        assert(uarray2 != NULL);
+        UArray2_map_spans(uarray2, (UArray2_spanfun*)apply, cl);
+}
+
 /********** small_closure ********
  * 
  * Modified struct to conform to the closure of apply_small
@@ -356,6 +405,8 @@ static struct A2Methods_T uarray2_methods_plain_struct = {
         small_map_col_major,
         NULL,                   /* small_map_block_major */
         small_map_row_major,    /* small_map_default */
+        map_hilbert,
+        map_spans,
 };
 
 /* finally the payoff: here is the exported pointer to the struct */
@@ -0,0 +1,9 @@
+#ifndef A2PLAIN_INCLUDED
+#define A2PLAIN_INCLUDED
+
+#include "a2methods.h"
+
+/* unblocked UArray2 arrays, mapped in row-major or column-major order */
+extern A2Methods_T uarray2_methods_plain;
+
+#endif
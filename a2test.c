@@ -4,6 +4,7 @@
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2morton.h"
 
 
 #define W 13
@@ -113,6 +114,24 @@ bool has_blocked_methods(A2Methods_T m)
         return m->map_default != NULL && m->map_block_major != NULL;
 }
 
+static void check_and_count(int i, int j, A2 a, void *elem, void *cl)
+{
+        (void)a;
+        unsigned *p = elem;
+        assert(*p == 1000 * (unsigned)i + j);
+        *(int *)cl += 1;
+}
+
+static void check_span_and_count(int i, int j, int len, A2 a, void *span,
+                                 void *cl)
+{
+        (void)a;
+        unsigned *p = span;
+        for (int k = 0; k < len; k++)
+                assert(p[k] == 1000 * (unsigned)(i + k) + j);
+        *(int *)cl += len;
+}
+
 static inline void copy_unsigned(A2Methods_T methods, A2 a,
                                  int i, int j, unsigned n) 
 {
@@ -157,6 +176,17 @@ static void test_methods(A2Methods_T methods_under_test)
                         assert(*p == n);
                 }
         }
+        /* every local suite has map_hilbert; the course library's suites
+           end before it */
+        assert(methods->map_hilbert != NULL);
+        int hilbert_visits = 0;
+        methods->map_hilbert(array, check_and_count, &hilbert_visits);
+        assert(hilbert_visits == W * H);
+        if (methods->map_spans) {
+                int visits = 0;
+                methods->map_spans(array, check_span_and_count, &visits);
+                assert(visits == W * H);
+        }
         double_row_major_plus();
         methods->free(&array);
 }
@@ -167,6 +197,12 @@ int main(int argc, char *argv[])
         (void)argv;
         test_methods(uarray2_methods_plain);
         test_methods(uarray2_methods_blocked);
+        test_methods(uarray2_methods_morton);
+
+        /* Z-order rows are not contiguous, so only the plain and blocked
+           suites map spans */
+        assert(uarray2_methods_plain->map_spans != NULL);
+        assert(uarray2_methods_blocked->map_spans != NULL);
         printf("Passed.\n");  /* only if we reach this point without
                                * assertion failure
                                */
@@ -0,0 +1,565 @@
+/**************************************************************
+ *
+ *                     batch.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements ppmtrans's batch mode. Running the
+ *              program once per image pays for process startup and for a
+ *              fresh pair of arrays every time; for small images that is
+ *              most of the cost. Here one process takes the whole list.
+ *              Each of the work pool's workers pulls the next image from
+ *              the list, maps it (so an 8-bit image is never copied in, see
+ *              Ppmio_map) and transforms it into a destination array that
+ *              the worker keeps from image to image, making a new one only
+ *              when the dimensions change. With the pipeline instead, the
+ *              images go one at a time through a read/transform/write
+ *              pipeline (see pipeline.c), so that the transformation of one
+ *              image, with every thread, overlaps the reading of the next
+ *              and the writing of the last. A stream of frames, images
+ *              written back to back to one file, goes through the same
+ *              pipeline, each frame read into the array of an earlier one.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "pnm.h"
+#include "ppmio.h"
+#include "workpool.h"
+#include "pipeline.h"
+#include "transformations.h"
+#include "cputiming.h"
+#include "batch.h"
+
+typedef A2Methods_UArray2 A2; /* private abbreviation */
+
+/********** batch_job ********
+ *
+ * A batch shared by every worker: the images, the transformation and the
+ * progress made so far.
+ *
+ *******************/
+struct batch_job {
+        char **paths;
+        int npaths;
+        const char *out_dir;
+        D4_T t;
+        A2Methods_T methods;
+        A2Methods_mapfun *map;
+        bool recursive;
+
+        pthread_mutex_t lock;   /* guards everything below */
+        int next;               /* the next image to take */
+        int failed;             /* images that could not be done */
+        double pixels;          /* pixels transformed */
+};
+
+/****************** add_path *******************
+ *
+ * Appends a copy of a path to a growing list.
+ *
+ ********************************************/
+static void add_path(char ***paths, int *npaths, int *capacity,
+                     const char *path)
+{
+        if (*npaths == *capacity) {
+                *capacity = *capacity == 0 ? 64 : 2 * *capacity;
+                RESIZE(*paths, (long)*capacity * sizeof **paths);
+        }
+        char *copy = ALLOC(strlen(path) + 1);
+        strcpy(copy, path);
+        (*paths)[(*npaths)++] = copy;
+}
+
+/****************** compare_paths *******************
+ *
+ * qsort comparison putting paths in name order.
+ *
+ ********************************************/
+static int compare_paths(const void *a, const void *b)
+{
+        return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/****************** list_images *******************
+ *
+ * Lists the images of a batch: the regular files of a directory, not
+ * counting hidden ones, in name order, or the lines of a list file, in
+ * order, skipping empty ones.
+ *
+ * Parameters:
+ *      const char *source: a directory or a list file
+ *      int *npaths:        set to the number of images
+ * Returns:
+ *      the paths, or NULL if source cannot be read
+ *
+ ********************************************/
+static char **list_images(const char *source, int *npaths)
+{
+        char **paths = NULL;
+        int capacity = 0;
+        *npaths = 0;
+
+        struct stat st;
+        if (stat(source, &st) == 0 && S_ISDIR(st.st_mode)) {
+                DIR *dir = opendir(source);
+                if (dir == NULL) {
+                        return NULL;
+                }
+                struct dirent *entry;
+                while ((entry = readdir(dir)) != NULL) {
+                        if (entry->d_name[0] == '.') {
+                                continue;
+                        }
+                        size_t n = strlen(source) + strlen(entry->d_name) + 2;
+                        char *path = ALLOC(n);
+                        snprintf(path, n, "%s/%s", source, entry->d_name);
+                        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+                                add_path(&paths, npaths, &capacity, path);
+                        }
+                        FREE(path);
+                }
+                closedir(dir);
+                if (*npaths > 0) {
+                        qsort(paths, *npaths, sizeof *paths, compare_paths);
+                }
+        } else {
+                FILE *list = fopen(source, "r");
+                if (list == NULL) {
+                        return NULL;
+                }
+                char *line = NULL;
+                size_t line_size = 0;
+                ssize_t len;
+                while ((len = getline(&line, &line_size, list)) != -1) {
+                        while (len > 0 && (line[len - 1] == '\n' ||
+                                           line[len - 1] == '\r')) {
+                                line[--len] = '\0';
+                        }
+                        if (len > 0) {
+                                add_path(&paths, npaths, &capacity, line);
+                        }
+                }
+                free(line);
+                fclose(list);
+        }
+        if (paths == NULL) {
+                /* an empty batch is not an error */
+                NEW(paths);
+        }
+        return paths;
+}
+
+/****************** out_path *******************
+ *
+ * Returns the output path of an image: its base name in the output
+ * directory. The caller frees it.
+ *
+ ********************************************/
+static char *out_path(const char *out_dir, const char *path)
+{
+        const char *base = strrchr(path, '/');
+        base = base == NULL ? path : base + 1;
+        size_t n = strlen(out_dir) + strlen(base) + 2;
+        char *out = ALLOC(n);
+        snprintf(out, n, "%s/%s", out_dir, base);
+        return out;
+}
+
+/****************** read_image *******************
+ *
+ * Reads one image of the batch, mapping it if possible. It runs on the
+ * pool's workers, which must not raise, so a malformed image is found by
+ * the return codes of Ppmio_scan_map and Ppmio_scan_next rather than by
+ * catching Pnm_Badformat.
+ *
+ * Parameters:
+ *      struct batch_job *job: the batch
+ *      const char *path:      the image
+ * Returns:
+ *      the image, or NULL if it could not be opened or is not a
+ *      well-formed P6 or P3 image
+ *
+ ********************************************/
+static Pnm_ppm read_image(struct batch_job *job, const char *path)
+{
+        Pnm_ppm p6 = NULL;
+        int read = Ppmio_scan_map(path, job->methods, &p6);
+        if (read == 0) {
+                FILE *fp = fopen(path, "r");
+                if (fp == NULL) {
+                        fprintf(stderr, "Error: Could not open file %s\n",
+                                path);
+                        return NULL;
+                }
+                read = Ppmio_scan_next(fp, job->methods, &p6);
+                fclose(fp);
+        }
+        if (read <= 0) {
+                if (p6 != NULL) {
+                        Pnm_ppmfree(&p6);
+                }
+                fprintf(stderr, "Error: %s is not a well-formed PPM image\n",
+                        path);
+                return NULL;
+        }
+        return p6;
+}
+
+/****************** write_image *******************
+ *
+ * Writes a transformed image of the batch to the output directory.
+ *
+ * Parameters:
+ *      struct batch_job *job: the batch
+ *      const char *path:      the image's input path
+ *      Pnm_ppm p6:            the transformed image
+ * Returns:
+ *      true if the image was written
+ *
+ ********************************************/
+static bool write_image(struct batch_job *job, const char *path, Pnm_ppm p6)
+{
+        char *out_name = out_path(job->out_dir, path);
+        FILE *out = fopen(out_name, "w");
+        if (out != NULL) {
+                Ppmio_write(out, p6);
+                fclose(out);
+        } else {
+                fprintf(stderr, "Error: Could not open file %s\n",
+                        out_name);
+        }
+        FREE(out_name);
+        return out != NULL;
+}
+
+/****************** count_image *******************
+ *
+ * Records an image as done, with its number of pixels, or as failed.
+ *
+ ********************************************/
+static void count_image(struct batch_job *job, double pixels, bool done)
+{
+        pthread_mutex_lock(&job->lock);
+        if (done) {
+                job->pixels += pixels;
+        } else {
+                job->failed++;
+        }
+        pthread_mutex_unlock(&job->lock);
+}
+
+/****************** do_image *******************
+ *
+ * Reads, transforms and writes one image of the batch.
+ *
+ * Parameters:
+ *      struct batch_job *job: the batch
+ *      const char *path:      the image
+ *      A2 *kept:              the worker's destination array, kept
+ *                             from image to image
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void do_image(struct batch_job *job, const char *path, A2 *kept)
+{
+        A2Methods_T methods = job->methods;
+        Pnm_ppm p6 = read_image(job, path);
+        if (p6 == NULL) {
+                count_image(job, 0, false);
+                return;
+        }
+        double pixels = (double)p6->width * p6->height;
+
+        /* the identity is written straight from the image */
+        bool reused = job->t != D4_IDENTITY;
+        if (reused) {
+                bool swaps = D4_swaps_dimensions(job->t);
+                int width = swaps ? p6->height : p6->width;
+                int height = swaps ? p6->width : p6->height;
+                A2 dst = reuse_destination(methods, p6->pixels, width,
+                                           height, kept);
+                p6 = output_driver(job->t, methods, job->map, job->recursive,
+                                   1, p6, methods, dst, NULL);
+        }
+
+        count_image(job, pixels, write_image(job, path, p6));
+
+        /* the worker keeps the destination for the next image */
+        if (reused) {
+                p6->pixels = NULL;
+                FREE(p6);
+        } else {
+                Pnm_ppmfree(&p6);
+        }
+}
+
+/****************** run_worker *******************
+ *
+ * Task of a batch: one worker's share. The worker takes images from the
+ * list until none are left, so fast workers take more of them.
+ *
+ ********************************************/
+static void run_worker(int i, void *cl)
+{
+        (void) i;
+        struct batch_job *job = cl;
+        A2 dst = NULL;
+        for (;;) {
+                pthread_mutex_lock(&job->lock);
+                int k = job->next < job->npaths ? job->next++ : -1;
+                pthread_mutex_unlock(&job->lock);
+                if (k < 0) {
+                        break;
+                }
+
+                do_image(job, job->paths[k], &dst);
+        }
+        if (dst != NULL) {
+                job->methods->free(&dst);
+        }
+}
+
+/****************** pipeline_read *******************
+ *
+ * Reader of the batch's pipeline: image k of the sequence is the kth of
+ * the list. A mapped image has nothing worth keeping, so the last one is
+ * freed, which unmaps it.
+ *
+ ********************************************/
+static bool pipeline_read(int k, Pnm_ppm *image, void *cl)
+{
+        struct batch_job *job = cl;
+        if (k >= job->npaths) {
+                return false;
+        }
+        if (*image != NULL) {
+                Pnm_ppmfree(image);
+        }
+        *image = read_image(job, job->paths[k]);
+        if (*image == NULL) {
+                count_image(job, 0, false);
+        }
+        return true;
+}
+
+/****************** pipeline_write *******************
+ *
+ * Writer of the batch's pipeline.
+ *
+ ********************************************/
+static void pipeline_write(int k, Pnm_ppm image, void *cl)
+{
+        struct batch_job *job = cl;
+        count_image(job, (double)image->width * image->height,
+                    write_image(job, job->paths[k], image));
+}
+
+/****************** Batch_run *******************
+ *
+ * Transforms every image of a batch, threads at a time, on the shared
+ * work pool. Each worker takes one task and pulls images itself, so that
+ * it can keep its destination array from one image to the next. Images
+ * are not split further: each is transformed and decoded by one thread.
+ * With pipelined set, the images instead go through the pipeline one at
+ * a time, each decoded and transformed with threads threads.
+ *
+ * Parameters:
+ *      const char *source:    a directory of images, or a list file
+ *      const char *out_dir:   the directory to write the images to
+ *      D4_T t:                the transformation
+ *      A2Methods_T methods:   methods for the arrays
+ *      A2Methods_mapfun *map: map function for the transformation
+ *      bool recursive:        use the cache-oblivious engine
+ *      int threads:           images transformed at once, or threads
+ *                             per image when pipelined
+ *      bool pipelined:        read, transform and write in a pipeline
+ *      FILE *time_file:       file for a summary of the run, or NULL
+ * Returns:
+ *      the number of images that could not be read or written, malformed
+ *      ones included, or -1 if source cannot be read
+ * Expects:
+ *      None of the pointers but time_file are NULL and threads is
+ *      positive (throws a CRE if not)
+ *
+ ********************************************/
+int Batch_run(const char *source, const char *out_dir, D4_T t,
+              A2Methods_T methods, A2Methods_mapfun *map, bool recursive,
+              int threads, bool pipelined, FILE *time_file)
+{
+        assert(source != NULL && out_dir != NULL);
+        assert(methods != NULL && map != NULL && threads > 0);
+
+        struct batch_job job;
+        job.paths = list_images(source, &job.npaths);
+        if (job.paths == NULL) {
+                return -1;
+        }
+        job.out_dir = out_dir;
+        job.t = t;
+        job.methods = methods;
+        job.map = map;
+        job.recursive = recursive;
+        pthread_mutex_init(&job.lock, NULL);
+        job.next = 0;
+        job.failed = 0;
+        job.pixels = 0;
+
+        /* parallelism is across images, so each is decoded by one thread,
+           unless the images go through the pipeline one at a time */
+        Ppmio_set_threads(pipelined ? threads : 1);
+
+        CPUTime_T timer = start_timer();
+        double wall_start = wall_clock();
+        int workers = threads < job.npaths ? threads : job.npaths;
+        if (pipelined) {
+                Pipeline_run(pipeline_read, pipeline_write, &job, t, methods,
+                             map, recursive, threads, time_file);
+        } else if (workers > 1) {
+                Workpool_run(Workpool_shared(workers), workers, run_worker,
+                             &job);
+        } else if (workers == 1) {
+                run_worker(0, &job);
+        }
+        double time_used = CPUTime_Stop(timer);
+        double wall_time = wall_clock() - wall_start;
+        CPUTime_Free(&timer);
+
+        if (time_file != NULL) {
+                fprintf(time_file, "Images in batch: %d (%d failed)\n",
+                        job.npaths, job.failed);
+                fprintf(time_file,
+                        "CPU time for batch: %f nanoseconds\n", time_used);
+                fprintf(time_file,
+                        "Wall-clock time for batch: %f nanoseconds\n",
+                        wall_time);
+                if (job.pixels > 0) {
+                        fprintf(time_file,
+                                "Wall-clock time per pixel: %f ns\n",
+                                wall_time / job.pixels);
+                }
+        }
+
+        for (int k = 0; k < job.npaths; k++) {
+                FREE(job.paths[k]);
+        }
+        FREE(job.paths);
+        pthread_mutex_destroy(&job.lock);
+        return job.failed;
+}
+
+/********** frame_stream ********
+ *
+ * A stream of frames being transformed: where they come from and go.
+ *
+ *******************/
+struct frame_stream {
+        FILE *in, *out;
+        A2Methods_T methods;
+        int frames;             /* frames written */
+        double pixels;          /* pixels transformed */
+};
+
+/****************** frame_read *******************
+ *
+ * Reader of a frame stream's pipeline: reads the next frame into the
+ * array of the frame the pipeline hands back, which is the same size in a
+ * steady stream.
+ *
+ ********************************************/
+static bool frame_read(int k, Pnm_ppm *image, void *cl)
+{
+        (void) k;
+        struct frame_stream *fs = cl;
+        return Ppmio_read_next(fs->in, fs->methods, image);
+}
+
+/****************** frame_write *******************
+ *
+ * Writer of a frame stream's pipeline: writes each frame out as soon as
+ * it is transformed.
+ *
+ ********************************************/
+static void frame_write(int k, Pnm_ppm image, void *cl)
+{
+        (void) k;
+        struct frame_stream *fs = cl;
+        Ppmio_write(fs->out, image);
+        fflush(fs->out);
+        fs->frames++;
+        fs->pixels += (double)image->width * image->height;
+}
+
+/****************** Batch_frames *******************
+ *
+ * Transforms a stream of frames, images written back to back such as the
+ * output of a capture, and writes each one out as soon as it is done. The
+ * frames go through the pipeline, so one frame is read while the one
+ * before it is transformed and the one before that written. Frames of the
+ * same size reuse the same few source and destination arrays.
+ *
+ * Parameters:
+ *      FILE *in:              the stream to read the frames from
+ *      FILE *out:             the stream to write them to
+ *      D4_T t:                the transformation
+ *      A2Methods_T methods:   methods for the arrays
+ *      A2Methods_mapfun *map: map function for the transformation
+ *      bool recursive:        use the cache-oblivious engine
+ *      int threads:           threads to transform each frame with
+ *      FILE *time_file:       file for each frame's latency and the
+ *                             throughput of the stream, or NULL
+ * Returns:
+ *      the number of frames
+ * Expects:
+ *      None of the pointers but time_file are NULL and threads is
+ *      positive (throws a CRE if not). Every frame is well formed; a
+ *      malformed one ends the program.
+ *
+ ********************************************/
+int Batch_frames(FILE *in, FILE *out, D4_T t, A2Methods_T methods,
+                 A2Methods_mapfun *map, bool recursive, int threads,
+                 FILE *time_file)
+{
+        assert(in != NULL && out != NULL);
+        assert(methods != NULL && map != NULL && threads > 0);
+        struct frame_stream fs = { in, out, methods, 0, 0 };
+
+        CPUTime_T timer = start_timer();
+        double wall_start = wall_clock();
+        Pipeline_run(frame_read, frame_write, &fs, t, methods, map,
+                     recursive, threads, time_file);
+        double time_used = CPUTime_Stop(timer);
+        double wall_time = wall_clock() - wall_start;
+        CPUTime_Free(&timer);
+
+        int frames = fs.frames;
+        if (time_file != NULL) {
+                fprintf(time_file, "Frames in stream: %d\n", frames);
+                fprintf(time_file,
+                        "CPU time for stream: %f nanoseconds\n", time_used);
+                fprintf(time_file,
+                        "Wall-clock time for stream: %f nanoseconds\n",
+                        wall_time);
+                if (frames > 0) {
+                        fprintf(time_file, "Frames per second: %f\n",
+                                frames / (wall_time / 1e9));
+                        fprintf(time_file,
+                                "Wall-clock time per pixel: %f ns\n",
+                                wall_time / fs.pixels);
+                }
+        }
+        return frames;
+}
@@ -0,0 +1,48 @@
+/**************************************************************
+ *
+ *                     batch.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for ppmtrans's batch and frame modes, which apply
+ *              one orientation change to many images in a single process:
+ *              the files of a list or directory, or the frames of a
+ *              stream.
+ *
+ **************************************************************/
+
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+#include "d4.h"
+
+/* transforms every image named by source (a directory, whose regular
+   files are taken in name order, or a file listing one path per line) by
+   t, writing each to the file of the same base name in out_dir. threads
+   images are transformed at once, each in one thread; if pipelined, the
+   images go one at a time through a read/transform/write pipeline, each
+   with threads threads. A summary of the run goes to time_file if it is
+   not NULL. A malformed image is skipped. Returns the number of images
+   that could not be read or written, malformed ones included, or -1 if
+   source cannot be read */
+extern int Batch_run(const char *source, const char *out_dir, D4_T t,
+                     A2Methods_T methods, A2Methods_mapfun *map,
+                     bool recursive, int threads, bool pipelined,
+                     FILE *time_file);
+
+/* transforms every frame of in, a stream of images written back to back,
+   by t, writing each to out as soon as it is done. Each frame is
+   transformed with threads threads while the next is read and the last
+   written. Each frame's latency and the stream's throughput go to
+   time_file if it is not NULL. Returns the number of frames */
+extern int Batch_frames(FILE *in, FILE *out, D4_T t, A2Methods_T methods,
+                        A2Methods_mapfun *map, bool recursive, int threads,
+                        FILE *time_file);
+
+#endif
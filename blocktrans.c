@@ -0,0 +1,313 @@
+/**************************************************************
+ *
+ *                     blocktrans.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the tile-pair engine. Source blocks are
+ *              visited in storage order. Each block is split where its image
+ *              crosses a destination block boundary, which gives at most
+ *              four regions, each landing inside a single destination
+ *              block. Each region is then copied by a kernel that walks the
+ *              source block with a pointer and steps through the destination
+ *              block with the fixed strides of the transformation. There is
+ *              no methods->at call or division per pixel.
+ *              
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "assert.h"
+#include "a2methods.h"
+#include "pnm.h"
+#include "uarray2b.h"
+#include "pixel.h"
+#include "blocktrans.h"
+
+/********** pair_job ********
+ * 
+ * The arrays, their blocksize and the source-to-destination coordinate map
+ * of the transformation being performed.
+ *
+ *******************/
+struct pair_job {
+        UArray2b_T src, dst;
+        int bs;
+        int size; /* cell size, see pixel.h */
+        D4_map m;
+};
+
+/********** COPY_CELLS ********
+ * 
+ * The inner loops of copy_region for cells of type CELL. Instantiated once
+ * per cell format, so that each copy is a fixed-size move.
+ *
+ *******************/
+#define COPY_CELLS(CELL) do {                                           \
+        CELL *s_row = (CELL *)sblock + sy * bs + sx;                    \
+        CELL *d_row = (CELL *)dblock + (dy % bs) * bs + dx % bs;        \
+        for (int y = y0; y < y1; y++, s_row += bs, d_row += step_row) { \
+                CELL *s = s_row;                                        \
+                CELL *d = d_row;                                        \
+                for (int k = 0; k < len; k++, s++, d += step_col) {     \
+                        *d = *s;                                        \
+                }                                                       \
+        }                                                               \
+} while (false)
+
+/****************** copy_region *******************
+ * 
+ * Copies the source cells [x0, x1) x [y0, y1), which lie in one source
+ * block and land in one destination block. Each step along a source row
+ * moves the destination pointer by a constant number of cells: +-1 for a
+ * flip or 180, +-blocksize when rows become columns.
+ *
+ * Parameters:
+ *      struct pair_job *job:  the transformation being performed
+ *      int x0, y0, x1, y1:    bounds of the source region
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      The region is non-empty, within one source block, and its image is
+ *      within one destination block
+ *
+ ********************************************/
+static void copy_region(struct pair_job *job, int x0, int y0, int x1, int y1)
+{
+        int bs = job->bs;
+        D4_map m = job->m;
+
+        /* source block and the region's offset within it */
+        char *sblock = UArray2b_block(job->src, x0 / bs, y0 / bs);
+        int sx = x0 % bs;
+        int sy = y0 % bs;
+
+        /* image of (x0, y0) and its destination block */
+        int dx = m.xx * x0 + m.xy * y0 + m.x0;
+        int dy = m.yx * x0 + m.yy * y0 + m.y0;
+        char *dblock = UArray2b_block(job->dst, dx / bs, dy / bs);
+
+        /* destination cell steps for one source column and one source row */
+        long step_col = (long)m.yx * bs + m.xx;
+        long step_row = (long)m.yy * bs + m.xy;
+
+        int len = x1 - x0;
+        if (job->size == (int)sizeof(Pixel_rgb8)) {
+                COPY_CELLS(Pixel_rgb8);
+        } else if (job->size == (int)sizeof(Pixel_rgb16)) {
+                COPY_CELLS(Pixel_rgb16);
+        } else {
+                COPY_CELLS(struct Pnm_rgb);
+        }
+}
+
+/****************** split_point *******************
+ * 
+ * Given a source range [lo, hi) along an axis whose destination coordinate
+ * is first + coef * (i - lo), returns the first index in the range whose
+ * destination coordinate is in a different block than that of lo, or hi
+ * if the whole range lands in one block.
+ *
+ * Parameters:
+ *      int lo, hi:  the source range
+ *      int first:   destination coordinate of index lo
+ *      int coef:    +1 or -1
+ *      int bs:      blocksize
+ * Returns:
+ *      the split index in (lo, hi], as described above
+ * Expects:
+ *      lo < hi
+ *
+ ********************************************/
+static int split_point(int lo, int hi, int first, int coef, int bs)
+{
+        /* cells left before the destination coordinate leaves its block */
+        int room = (coef > 0) ? bs - first % bs : first % bs + 1;
+        return (hi - lo > room) ? lo + room : hi;
+}
+
+/****************** copy_block *******************
+ * 
+ * Copies the used cells [x0, x1) x [y0, y1) of one source block, splitting
+ * them where their image crosses destination block boundaries.
+ *
+ * Parameters:
+ *      struct pair_job *job:  the transformation being performed
+ *      int x0, y0, x1, y1:    bounds of the used part of the source block
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      The bounds lie within one source block
+ *
+ ********************************************/
+static void copy_block(struct pair_job *job, int x0, int y0, int x1, int y1)
+{
+        D4_map m = job->m;
+        int bs = job->bs;
+        int dx = m.xx * x0 + m.xy * y0 + m.x0;
+        int dy = m.yx * x0 + m.yy * y0 + m.y0;
+
+        /* the source axis that drives each destination axis, and its sign */
+        int xsplit = x1, ysplit = y1;
+        if (m.xx != 0) {
+                xsplit = split_point(x0, x1, dx, m.xx, bs);
+        } else {
+                ysplit = split_point(y0, y1, dx, m.xy, bs);
+        }
+        if (m.yx != 0) {
+                xsplit = split_point(x0, x1, dy, m.yx, bs);
+        } else {
+                ysplit = split_point(y0, y1, dy, m.yy, bs);
+        }
+
+        copy_region(job, x0, y0, xsplit, ysplit);
+        if (xsplit < x1) {
+                copy_region(job, xsplit, y0, x1, ysplit);
+        }
+        if (ysplit < y1) {
+                copy_region(job, x0, ysplit, xsplit, y1);
+                if (xsplit < x1) {
+                        copy_region(job, xsplit, ysplit, x1, y1);
+                }
+        }
+}
+
+/****************** init_job *******************
+ * 
+ * Fills in the job for transforming src into dst under t.
+ *
+ * Parameters:
+ *      struct pair_job *job: the job to fill in
+ *      UArray2b_T src, dst:  original array and destination
+ *      D4_T t:               which transformation to perform
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      src and dst are not NULL, dst has the transformed dimensions and
+ *      both have the same blocksize and cell size (throws a CRE otherwise)
+ *
+ ********************************************/
+static void init_job(struct pair_job *job, UArray2b_T src, UArray2b_T dst,
+                     D4_T t)
+{
+        assert(src != NULL && dst != NULL);
+        int w = UArray2b_width(src);
+        int h = UArray2b_height(src);
+        int bs = UArray2b_blocksize(src);
+        bool swaps = D4_swaps_dimensions(t);
+        assert(UArray2b_width(dst) == (swaps ? h : w));
+        assert(UArray2b_height(dst) == (swaps ? w : h));
+        assert(UArray2b_blocksize(dst) == bs);
+        int size = UArray2b_size(src);
+        assert(UArray2b_size(dst) == size);
+        assert(size == (int)sizeof(Pixel_rgb8) ||
+               size == (int)sizeof(Pixel_rgb16) ||
+               size == (int)sizeof(struct Pnm_rgb));
+
+        job->src = src;
+        job->dst = dst;
+        job->bs = bs;
+        job->size = size;
+        job->m = D4_affine(t, w, h);
+}
+
+/****************** Blocktrans_nblocks *******************
+ * 
+ * Returns the number of blocks in a UArray2b, which is the range of block
+ * indices Blocktrans_transform_blocks accepts.
+ *
+ * Parameters:
+ *      UArray2b_T array: a blocked array
+ * Returns:
+ *      the number of blocks it is stored in
+ * Expects:
+ *      array is not NULL (throws a CRE if NULL)
+ *
+ ********************************************/
+extern int Blocktrans_nblocks(UArray2b_T array)
+{
+        assert(array != NULL);
+        int bs = UArray2b_blocksize(array);
+        int across = (UArray2b_width(array) + bs - 1) / bs;
+        int down = (UArray2b_height(array) + bs - 1) / bs;
+        return across * down;
+}
+
+/****************** Blocktrans_transform_blocks *******************
+ * 
+ * Copies the pixels of count source blocks, starting at block number first
+ * in storage order, to their transformed spots in dst. Disjoint source
+ * blocks have disjoint images, so threads may transform different runs of
+ * blocks of the same arrays at once.
+ *
+ * Parameters:
+ *      UArray2b_T src: original array
+ *      UArray2b_T dst: destination, of transformed dimensions
+ *      D4_T t:         which transformation to perform
+ *      int first:      storage index of the first block to copy
+ *      int count:      number of blocks to copy
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      As Blocktrans_transform, and the blocks exist in src (throws a CRE
+ *      otherwise)
+ *
+ ********************************************/
+extern void Blocktrans_transform_blocks(UArray2b_T src, UArray2b_T dst,
+                                        D4_T t, int first, int count)
+{
+        struct pair_job job;
+        init_job(&job, src, dst, t);
+        assert(first >= 0 && count >= 0);
+        assert(first + count <= Blocktrans_nblocks(src));
+
+        int w = UArray2b_width(src);
+        int h = UArray2b_height(src);
+        int bs = job.bs;
+        int across = (w + bs - 1) / bs;
+
+        /* under the identity both arrays have the same blocks, stored in
+           the same order, so the run of blocks is one copy */
+        if (t == D4_IDENTITY) {
+                if (count > 0) {
+                        int bx = first % across, by = first / across;
+                        memcpy(UArray2b_block(dst, bx, by),
+                               UArray2b_block(src, bx, by),
+                               (size_t)count * bs * bs * job.size);
+                }
+                return;
+        }
+        for (int b = first; b < first + count; b++) {
+                int x0 = (b % across) * bs;
+                int y0 = (b / across) * bs;
+                int x1 = (x0 + bs < w) ? x0 + bs : w;
+                int y1 = (y0 + bs < h) ? y0 + bs : h;
+                copy_block(&job, x0, y0, x1, y1);
+        }
+}
+
+/****************** Blocktrans_transform *******************
+ * 
+ * Copies every pixel of src to its transformed spot in dst, one source
+ * block at a time, in the order the blocks are stored.
+ *
+ * Parameters:
+ *      UArray2b_T src: original array
+ *      UArray2b_T dst: destination, of transformed dimensions
+ *      D4_T t:         which transformation to perform
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      src and dst are not NULL, dst has the transformed dimensions and
+ *      both have the same blocksize and cell size (throws a CRE otherwise)
+ *
+ ********************************************/
+extern void Blocktrans_transform(UArray2b_T src, UArray2b_T dst, D4_T t)
+{
+        assert(src != NULL);
+        Blocktrans_transform_blocks(src, dst, t, 0, Blocktrans_nblocks(src));
+}
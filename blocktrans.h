@@ -0,0 +1,39 @@
+/**************************************************************
+ *
+ *                     blocktrans.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for the tile-pair transformation engine for
+ *              blocked arrays. Under any orientation change, a source block
+ *              lands on at most four destination blocks (one when the
+ *              reversed dimensions are multiples of the blocksize), with a
+ *              fixed permutation of cells. The engine copies each source
+ *              block straight into those destination blocks, so reads and
+ *              writes stay within a pair of L1-resident blocks.
+ *              
+ **************************************************************/
+
+#ifndef BLOCKTRANS_INCLUDED
+#define BLOCKTRANS_INCLUDED
+
+#include "uarray2b.h"
+#include "d4.h"
+
+/* copies every pixel of src to its spot in dst under transformation t;
+   dst must already have the transformed dimensions and the same
+   blocksize as src, and both arrays must hold cells of the same pixel.h
+   format */
+extern void Blocktrans_transform(UArray2b_T src, UArray2b_T dst, D4_T t);
+
+/* the same, for count source blocks starting at storage index first;
+   threads may transform disjoint runs of blocks of the same arrays at once */
+extern void Blocktrans_transform_blocks(UArray2b_T src, UArray2b_T dst,
+                                        D4_T t, int first, int count);
+
+/* number of blocks in array, i.e. the range of storage indices */
+extern int Blocktrans_nblocks(UArray2b_T array);
+
+#endif
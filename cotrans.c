@@ -0,0 +1,241 @@
+/**************************************************************
+ *
+ *                     cotrans.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the cache-oblivious transformation
+ *              engine. The source rectangle is halved along its longer side
+ *              until it takes at most TILE_BYTES, and then each tile
+ *              is copied to the destination. No cache size is assumed:
+ *              every level of the recursion is a smaller, more local
+ *              subproblem, so each cache level is used by whichever level
+ *              of tiles happens to fit in it.
+ *              
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "assert.h"
+#include "a2methods.h"
+#include "pnm.h"
+#include "pixel.h"
+#include "cotrans.h"
+
+typedef A2Methods_UArray2 A2; /* private abbreviation */
+
+/* base case: a tile of at most 12KB (32 x 32 wide pixels, or 64 x 64
+   packed ones) and its image */
+#define TILE_BYTES (12 * 1024)
+
+/********** co_job ********
+ * 
+ * Everything the recursion needs about one transformation: the arrays, the
+ * source dimensions, and how far a source row can be walked with a pointer.
+ * run_cells is the width of a contiguous run within a source row: the whole
+ * row for a UArray2, one block row for a UArray2b, and 1 for layouts whose
+ * rows are not contiguous.
+ *
+ *******************/
+struct co_job {
+        A2Methods_T methods;     /* of src */
+        A2Methods_T dst_methods; /* of dst */
+        A2 src, dst;
+        int width, height; /* dimensions of src */
+        int run_cells;     /* cells per contiguous run in a source row */
+        int size;          /* cell size, see pixel.h */
+        long tile_cells;   /* most cells in a base-case tile */
+        D4_map map;        /* source to destination coordinates */
+};
+
+/****************** copy_tile *******************
+ * 
+ * Copies the pixels of the source tile [c0, c1) x [r0, r1) to their
+ * transformed spots in the destination. Each source row is read in
+ * contiguous runs with a pointer; destination cells are found with at.
+ *
+ * Parameters:
+ *      struct co_job *job:  the transformation being performed
+ *      int c0, r0, c1, r1:  bounds of the source tile
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      The tile lies within the source array
+ *
+ ********************************************/
+static void copy_tile(struct co_job *job, int c0, int r0, int c1, int r1)
+{
+        A2Methods_Object *(*at)(A2, int, int) = job->methods->at;
+        A2Methods_Object *(*dst_at)(A2, int, int) = job->dst_methods->at;
+        A2 src = job->src;
+        A2 dst = job->dst;
+        int run = job->run_cells;
+        int size = job->size;
+        D4_map m = job->map;
+
+        for (int r = r0; r < r1; r++) {
+                int c = c0;
+                while (c < c1) {
+                        /* end of the contiguous run that holds column c */
+                        int end = (c / run + 1) * run;
+                        if (end > c1) {
+                                end = c1;
+                        }
+                        char *p = at(src, c, r);
+                        int x = m.xx * c + m.xy * r + m.x0;
+                        int y = m.yx * c + m.yy * r + m.y0;
+                        for (; c < end; c++, p += size, x += m.xx, 
+                                                        y += m.yx) {
+                                Pixel_copy(dst_at(dst, x, y), p, size);
+                        }
+                }
+        }
+}
+
+/****************** recurse *******************
+ * 
+ * Transforms the source rectangle [c0, c1) x [r0, r1) by halving its
+ * longer side until it is no bigger than a base-case tile.
+ *
+ * Parameters:
+ *      struct co_job *job:  the transformation being performed
+ *      int c0, r0, c1, r1:  bounds of the source rectangle
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      The rectangle lies within the source array
+ *
+ ********************************************/
+static void recurse(struct co_job *job, int c0, int r0, int c1, int r1)
+{
+        int w = c1 - c0;
+        int h = r1 - r0;
+        if ((long)w * h <= job->tile_cells) {
+                copy_tile(job, c0, r0, c1, r1);
+        } else if (w >= h) {
+                recurse(job, c0, r0, c0 + w / 2, r1);
+                recurse(job, c0 + w / 2, r0, c1, r1);
+        } else {
+                recurse(job, c0, r0, c1, r0 + h / 2);
+                recurse(job, c0, r0 + h / 2, c1, r1);
+        }
+}
+
+/****************** init_job *******************
+ * 
+ * Fills in the job for transforming src into dst under t.
+ *
+ * Parameters:
+ *      struct co_job *job:      the job to fill in
+ *      A2Methods_T methods:     methods for src
+ *      A2 src:                  original array
+ *      A2Methods_T dst_methods: methods for dst
+ *      A2 dst:                  destination
+ *      D4_T t:                  which transformation to perform
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers will be NULL (throws a CRE if NULL).
+ *      dst has the dimensions of src after the transformation (throws a
+ *      CRE otherwise).
+ *
+ ********************************************/
+static void init_job(struct co_job *job, A2Methods_T methods, A2 src,
+                     A2Methods_T dst_methods, A2 dst, D4_T t)
+{
+        assert(job != NULL);
+        assert(methods != NULL && src != NULL);
+        assert(dst_methods != NULL && dst != NULL);
+        job->methods = methods;
+        job->dst_methods = dst_methods;
+        job->src = src;
+        job->dst = dst;
+        job->width = methods->width(src);
+        job->height = methods->height(src);
+        job->map = D4_affine(t, job->width, job->height);
+        job->size = methods->size(src);
+        assert(dst_methods->size(dst) == job->size);
+        job->tile_cells = TILE_BYTES / job->size;
+
+        bool swaps = D4_swaps_dimensions(t);
+        assert(dst_methods->width(dst) == 
+               (swaps ? job->height : job->width));
+        assert(dst_methods->height(dst) == 
+               (swaps ? job->width : job->height));
+
+        /* rows of arrays without map_spans are not assumed contiguous */
+        int blocksize = methods->blocksize(src);
+        if (methods->map_spans == NULL) {
+                job->run_cells = 1;
+        } else if (blocksize > 0) {
+                job->run_cells = blocksize;
+        } else {
+                job->run_cells = job->width;
+        }
+}
+
+/****************** CO_transform *******************
+ * 
+ * Copies every pixel of src to its transformed spot in dst using the
+ * cache-oblivious recursion.
+ *
+ * Parameters:
+ *      A2Methods_T methods:     methods for src
+ *      A2 src:                  original array
+ *      A2Methods_T dst_methods: methods for dst, which may differ, e.g. a
+ *                               plain view of an output file
+ *      A2 dst:                  destination, of transformed dimensions
+ *      D4_T t:                  which transformation to perform
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers will be NULL (throws a CRE if NULL).
+ *      dst has the dimensions of src after the transformation (throws a
+ *      CRE otherwise).
+ *
+ ********************************************/
+extern void CO_transform(A2Methods_T methods, A2 src, A2Methods_T dst_methods,
+                         A2 dst, D4_T t)
+{
+        struct co_job job;
+        init_job(&job, methods, src, dst_methods, dst, t);
+        recurse(&job, 0, 0, job.width, job.height);
+}
+
+/****************** CO_transform_region *******************
+ * 
+ * Like CO_transform, but copies only the source rectangle [c0, c1) x
+ * [r0, r1). The images of disjoint source rectangles are disjoint, so
+ * different threads may transform different rectangles of the same pair
+ * of arrays at once.
+ *
+ * Parameters:
+ *      A2Methods_T methods:     methods for src
+ *      A2 src:                  original array
+ *      A2Methods_T dst_methods: methods for dst, which may differ, e.g. a
+ *                               plain view of an output file
+ *      A2 dst:                  destination, of transformed dimensions
+ *      D4_T t:                  which transformation to perform
+ *      int c0, r0, c1, r1:      bounds of the source rectangle
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      As CO_transform, and the rectangle lies within src (throws a CRE
+ *      otherwise).
+ *
+ ********************************************/
+extern void CO_transform_region(A2Methods_T methods, A2 src,
+                                A2Methods_T dst_methods, A2 dst, D4_T t,
+                                int c0, int r0, int c1, int r1)
+{
+        struct co_job job;
+        init_job(&job, methods, src, dst_methods, dst, t);
+        assert(0 <= c0 && c0 <= c1 && c1 <= job.width);
+        assert(0 <= r0 && r0 <= r1 && r1 <= job.height);
+        if (c0 < c1 && r0 < r1) {
+                recurse(&job, c0, r0, c1, r1);
+        }
+}
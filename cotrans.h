@@ -0,0 +1,40 @@
+/**************************************************************
+ *
+ *                     cotrans.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for the cache-oblivious transformation engine.
+ *              Rather than following one traversal order, the engine splits
+ *              the image into halves recursively until a tile is small
+ *              enough to sit in cache together with its image in the
+ *              destination. Only then are pixels copied, so reads and
+ *              writes both stay local at every cache level. Used by
+ *              rotation_driver and transpose_driver for ppmtrans -recursive.
+ *              
+ **************************************************************/
+
+#ifndef COTRANS_INCLUDED
+#define COTRANS_INCLUDED
+
+#include "a2methods.h"
+#include "d4.h"
+
+/* copies every pixel of src to its spot in dst under transformation t;
+   dst must already have the transformed dimensions, and both arrays must
+   hold cells of the same pixel.h format. src uses methods and dst uses
+   dst_methods, which need not be the same suite */
+extern void CO_transform(A2Methods_T methods, A2Methods_UArray2 src,
+                         A2Methods_T dst_methods, A2Methods_UArray2 dst,
+                         D4_T t);
+
+/* the same, for the source rectangle [c0, c1) x [r0, r1) only; threads may
+   transform disjoint rectangles of the same arrays at once */
+extern void CO_transform_region(A2Methods_T methods, A2Methods_UArray2 src,
+                                A2Methods_T dst_methods,
+                                A2Methods_UArray2 dst, D4_T t,
+                                int c0, int r0, int c1, int r1);
+
+#endif
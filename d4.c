@@ -0,0 +1,111 @@
+/**************************************************************
+ *
+ *                     d4.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the D4 interface: the coordinate maps
+ *              of the eight image orientations.
+ *              
+ **************************************************************/
+
+#include "assert.h"
+#include "d4.h"
+
+/****************** D4_affine *******************
+ * 
+ * Returns the affine map that takes a pixel's coordinates in a source image
+ * of the given dimensions to its coordinates after transformation t.
+ *
+ * Parameters:
+ *      D4_T t:     the transformation
+ *      int width:  width of the source image
+ *      int height: height of the source image
+ * Returns:
+ *      the D4_map for t
+ * Expects:
+ *      t is one of the eight D4_T values (throws a CRE otherwise)
+ *
+ ********************************************/
+extern D4_map D4_affine(D4_T t, int width, int height)
+{
+        int w = width - 1;
+        int h = height - 1;
+        switch (t) {
+        case D4_IDENTITY:
+                return (D4_map){  1,  0, 0,   0,  1, 0 };
+        case D4_ROTATE_90:
+                return (D4_map){  0, -1, h,   1,  0, 0 };
+        case D4_ROTATE_180:
+                return (D4_map){ -1,  0, w,   0, -1, h };
+        case D4_ROTATE_270:
+                return (D4_map){  0,  1, 0,  -1,  0, w };
+        case D4_FLIP_HORIZONTAL:
+                return (D4_map){ -1,  0, w,   0,  1, 0 };
+        case D4_FLIP_VERTICAL:
+                return (D4_map){  1,  0, 0,   0, -1, h };
+        case D4_TRANSPOSE:
+                return (D4_map){  0,  1, 0,   1,  0, 0 };
+        case D4_TRANSVERSE:
+                return (D4_map){  0, -1, h,  -1,  0, w };
+        }
+        assert(0);
+        return (D4_map){ 1, 0, 0, 0, 1, 0 };
+}
+
+/****************** D4_swaps_dimensions *******************
+ * 
+ * Returns whether transformation t exchanges the width and height.
+ *
+ * Parameters:
+ *      D4_T t: the transformation
+ * Returns:
+ *      true for the 90 and 270 degree rotations, transpose and transverse
+ * Expects:
+ *      None
+ *
+ ********************************************/
+extern bool D4_swaps_dimensions(D4_T t)
+{
+        return t == D4_ROTATE_90 || t == D4_ROTATE_270 ||
+               t == D4_TRANSPOSE || t == D4_TRANSVERSE;
+}
+
+/****************** D4_compose *******************
+ * 
+ * Returns the element of the group that does the same as applying first
+ * and then second. Only the linear parts of the maps matter: the offsets
+ * just keep the image in the destination's bounds, and the linear part
+ * determines the element. So the product of the two 2x2 matrices is
+ * looked up among the eight elements.
+ *
+ * Parameters:
+ *      D4_T first:  the transformation applied first
+ *      D4_T second: the transformation applied to its result
+ * Returns:
+ *      the composition of the two
+ * Expects:
+ *      Both are elements of D4_T
+ *
+ ********************************************/
+extern D4_T D4_compose(D4_T first, D4_T second)
+{
+        /* a 1x1 image has no offsets, leaving only the linear parts */
+        D4_map a = D4_affine(first, 1, 1);
+        D4_map b = D4_affine(second, 1, 1);
+        D4_map ab = {
+                b.xx * a.xx + b.xy * a.yx, b.xx * a.xy + b.xy * a.yy, 0,
+                b.yx * a.xx + b.yy * a.yx, b.yx * a.xy + b.yy * a.yy, 0
+        };
+        for (D4_T t = D4_IDENTITY; t <= D4_TRANSVERSE; t++) {
+                D4_map m = D4_affine(t, 1, 1);
+                if (m.xx == ab.xx && m.xy == ab.xy &&
+                    m.yx == ab.yx && m.yy == ab.yy) {
+                        return t;
+                }
+        }
+        assert(0);
+        return D4_IDENTITY;
+}
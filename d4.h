@@ -0,0 +1,51 @@
+/**************************************************************
+ *
+ *                     d4.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for the eight orientation-changing transformations
+ *              of an image (the dihedral group D4): the four rotations, the
+ *              two flips, transpose and transverse. Each one can be turned
+ *              into an affine map from source to destination coordinates,
+ *              so kernels can step through both images with fixed strides.
+ *              
+ **************************************************************/
+
+#ifndef D4_INCLUDED
+#define D4_INCLUDED
+
+#include <stdbool.h>
+
+typedef enum {
+        D4_IDENTITY,
+        D4_ROTATE_90,
+        D4_ROTATE_180,
+        D4_ROTATE_270,
+        D4_FLIP_HORIZONTAL,
+        D4_FLIP_VERTICAL,
+        D4_TRANSPOSE,
+        D4_TRANSVERSE     /* transpose across the other diagonal */
+} D4_T;
+
+/* pixel (col, row) of the source lands on
+     col' = xx * col + xy * row + x0
+     row' = yx * col + yy * row + y0
+   in the destination; every coefficient is -1, 0 or 1 */
+typedef struct D4_map {
+        int xx, xy, x0;
+        int yx, yy, y0;
+} D4_map;
+
+/* affine map of t for a source image of the given dimensions */
+extern D4_map D4_affine(D4_T t, int width, int height);
+
+/* true if t exchanges the width and height of the image */
+extern bool D4_swaps_dimensions(D4_T t);
+
+/* the single transformation equal to applying first and then second */
+extern D4_T D4_compose(D4_T first, D4_T second);
+
+#endif
@@ -0,0 +1,208 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "assert.h"
+#include "d4.h"
+
+/* image sizes to check every map on: square, wide, tall and degenerate */
+static const int sizes[][2] = {
+        { 1, 1 }, { 4, 4 }, { 5, 3 }, { 3, 5 }, { 7, 1 }, { 1, 6 }
+};
+#define NSIZES ((int)(sizeof(sizes) / sizeof(sizes[0])))
+
+/* where the course's description of each transformation sends pixel
+   (i, j) of a w x h image, written out by hand rather than from d4.c */
+static void reference(D4_T t, int w, int h, int i, int j, int *ri, int *rj)
+{
+        switch (t) {
+        case D4_IDENTITY:        *ri = i;         *rj = j;         break;
+        case D4_ROTATE_90:       *ri = h - j - 1; *rj = i;         break;
+        case D4_ROTATE_180:      *ri = w - i - 1; *rj = h - j - 1; break;
+        case D4_ROTATE_270:      *ri = j;         *rj = w - i - 1; break;
+        case D4_FLIP_HORIZONTAL: *ri = w - i - 1; *rj = j;         break;
+        case D4_FLIP_VERTICAL:   *ri = i;         *rj = h - j - 1; break;
+        case D4_TRANSPOSE:       *ri = j;         *rj = i;         break;
+        case D4_TRANSVERSE:      *ri = h - j - 1; *rj = w - i - 1; break;
+        }
+}
+
+static void apply(D4_map m, int i, int j, int *ri, int *rj)
+{
+        *ri = m.xx * i + m.xy * j + m.x0;
+        *rj = m.yx * i + m.yy * j + m.y0;
+}
+
+/* dimensions of a w x h image after t */
+static void resize(D4_T t, int *w, int *h)
+{
+        if (D4_swaps_dimensions(t)) {
+                int tmp = *w;
+                *w = *h;
+                *h = tmp;
+        }
+}
+
+/* D4_affine agrees with the reference, and keeps every pixel in bounds */
+static void test_affine(void)
+{
+        for (int s = 0; s < NSIZES; s++) {
+                int w = sizes[s][0], h = sizes[s][1];
+                for (D4_T t = D4_IDENTITY; t <= D4_TRANSVERSE; t++) {
+                        D4_map m = D4_affine(t, w, h);
+                        int dw = w, dh = h;
+                        resize(t, &dw, &dh);
+                        for (int i = 0; i < w; i++) {
+                                for (int j = 0; j < h; j++) {
+                                        int ai, aj, ri, rj;
+                                        apply(m, i, j, &ai, &aj);
+                                        reference(t, w, h, i, j, &ri, &rj);
+                                        assert(ai == ri && aj == rj);
+                                        assert(0 <= ai && ai < dw);
+                                        assert(0 <= aj && aj < dh);
+                                }
+                        }
+                }
+        }
+}
+
+/* D4_swaps_dimensions is true for exactly the quarter turns and the two
+   transposes */
+static void test_swaps(void)
+{
+        static const bool swaps[] = {
+                false, true, false, true, false, false, true, true
+        };
+        for (D4_T t = D4_IDENTITY; t <= D4_TRANSVERSE; t++) {
+                assert(D4_swaps_dimensions(t) == swaps[t]);
+        }
+}
+
+/* pixel (i, j) of a w x h image after applying n steps one at a time */
+static void step_by_step(const D4_T *steps, int n, int w, int h, int i,
+                         int j, int *ri, int *rj)
+{
+        for (int k = 0; k < n; k++) {
+                int ni, nj;
+                reference(steps[k], w, h, i, j, &ni, &nj);
+                resize(steps[k], &w, &h);
+                i = ni;
+                j = nj;
+        }
+        *ri = i;
+        *rj = j;
+}
+
+/* D4_compose(first, second) moves every pixel where first then second
+   does, for all 8 x 8 pairs */
+static void test_compose(void)
+{
+        for (D4_T a = D4_IDENTITY; a <= D4_TRANSVERSE; a++) {
+                for (D4_T b = D4_IDENTITY; b <= D4_TRANSVERSE; b++) {
+                        D4_T steps[2] = { a, b };
+                        D4_T ab = D4_compose(a, b);
+                        for (int s = 0; s < NSIZES; s++) {
+                                int w = sizes[s][0], h = sizes[s][1];
+                                D4_map m = D4_affine(ab, w, h);
+                                for (int i = 0; i < w; i++) {
+                                        for (int j = 0; j < h; j++) {
+                                                int ci, cj, si, sj;
+                                                apply(m, i, j, &ci, &cj);
+                                                step_by_step(steps, 2, w, h,
+                                                             i, j, &si, &sj);
+                                                assert(ci == si && cj == sj);
+                                        }
+                                }
+                        }
+                }
+        }
+}
+
+/* the step of one ppmtrans option and its value, as ppmtrans parses it */
+static D4_T option_step(const char *option, const char *value)
+{
+        if (strcmp(option, "-rotate") == 0) {
+                if (strcmp(value, "90") == 0)
+                        return D4_ROTATE_90;
+                if (strcmp(value, "180") == 0)
+                        return D4_ROTATE_180;
+                if (strcmp(value, "270") == 0)
+                        return D4_ROTATE_270;
+                assert(strcmp(value, "0") == 0);
+                return D4_IDENTITY;
+        }
+        if (strcmp(option, "-flip") == 0) {
+                if (strcmp(value, "horizontal") == 0)
+                        return D4_FLIP_HORIZONTAL;
+                assert(strcmp(value, "vertical") == 0);
+                return D4_FLIP_VERTICAL;
+        }
+        assert(strcmp(option, "-transpose") == 0);
+        return D4_TRANSPOSE;
+}
+
+/* option sequences, NULL-terminated, each with the one orientation it
+   reduces to */
+static const struct {
+        const char *args[12];
+        D4_T expected;
+} sequences[] = {
+        { { NULL }, D4_IDENTITY },
+        { { "-rotate", "90", "-rotate", "90", NULL }, D4_ROTATE_180 },
+        { { "-rotate", "90", "-rotate", "270", NULL }, D4_IDENTITY },
+        { { "-transpose", "-rotate", "180", NULL }, D4_TRANSVERSE },
+        { { "-rotate", "90", "-flip", "horizontal", NULL }, D4_TRANSPOSE },
+        { { "-flip", "horizontal", "-rotate", "90", NULL }, D4_TRANSVERSE },
+        { { "-flip", "horizontal", "-flip", "vertical", NULL },
+          D4_ROTATE_180 },
+        { { "-transpose", "-transpose", NULL }, D4_IDENTITY },
+        { { "-rotate", "0", "-rotate", "270", "-transpose", NULL },
+          D4_FLIP_HORIZONTAL },
+        { { "-rotate", "90", "-flip", "vertical", "-transpose", "-rotate",
+            "180", "-flip", "horizontal", NULL }, D4_FLIP_HORIZONTAL },
+};
+#define NSEQUENCES ((int)(sizeof(sequences) / sizeof(sequences[0])))
+
+/* a sequence of options composes, as ppmtrans folds it, into the
+   orientation that moves every pixel where the steps do one at a time */
+static void test_sequences(void)
+{
+        for (int q = 0; q < NSEQUENCES; q++) {
+                D4_T steps[12];
+                int n = 0;
+                D4_T orientation = D4_IDENTITY;
+                const char *const *args = sequences[q].args;
+                for (int k = 0; args[k] != NULL; k++) {
+                        bool valued = strcmp(args[k], "-transpose") != 0;
+                        steps[n] = option_step(args[k],
+                                               valued ? args[k + 1] : NULL);
+                        orientation = D4_compose(orientation, steps[n++]);
+                        k += valued;
+                }
+                assert(orientation == sequences[q].expected);
+                for (int s = 0; s < NSIZES; s++) {
+                        int w = sizes[s][0], h = sizes[s][1];
+                        D4_map m = D4_affine(orientation, w, h);
+                        for (int i = 0; i < w; i++) {
+                                for (int j = 0; j < h; j++) {
+                                        int ci, cj, si, sj;
+                                        apply(m, i, j, &ci, &cj);
+                                        step_by_step(steps, n, w, h, i, j,
+                                                     &si, &sj);
+                                        assert(ci == si && cj == sj);
+                                }
+                        }
+                }
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        assert(argc == 1);
+        (void)argv;
+        test_affine();
+        test_swaps();
+        test_compose();
+        test_sequences();
+        printf("Passed.\n");
+        return 0;
+}
@@ -0,0 +1,112 @@
+/**************************************************************
+ *
+ *                     hilbert.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements Hilbert_map, which walks every point of
+ *              a width x height grid along a Hilbert curve. The curve is
+ *              defined over the smallest power-of-two square that holds the
+ *              grid. Sub-squares that lie wholly outside the grid are
+ *              pruned, so non-square grids cost no more than their own
+ *              points.
+ *              
+ **************************************************************/
+
+#include <stdlib.h>
+
+#include "assert.h"
+#include "hilbert.h"
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/********** hilbert_closure ********
+ * 
+ * Grid bounds and the visit function, shared by every level of the walk.
+ *
+ *******************/
+struct hilbert_closure {
+        int width, height;
+        Hilbert_visitfun *visit;
+        void *cl;
+};
+
+/****************** walk *******************
+ * 
+ * Walks one square of the curve. The square has a corner at (x0, y0) and
+ * is spanned by the vectors (xi, xj) and (yi, yj). The curve starts in the
+ * quadrant at (x0, y0), moves along the first vector, then across the
+ * second, and ends in the quadrant next to the far end of the second
+ * vector. Exactly one component of each vector is non-zero, and its
+ * magnitude is the side of the square. Each quadrant is walked
+ * recursively in the orientation the Hilbert curve requires.
+ *
+ * Parameters:
+ *      int x0, y0:   corner of the square where the curve enters
+ *      int xi, xj:   first spanning vector
+ *      int yi, yj:   second spanning vector
+ *      struct hilbert_closure *hc: grid bounds and visit function
+ * Returns:
+ *      None
+ * Expects:
+ *      The side of the square is a power of two
+ *
+ ********************************************/
+static void walk(int x0, int y0, int xi, int xj, int yi, int yj,
+                 struct hilbert_closure *hc)
+{
+        /* lowest-numbered cell covered by this square */
+        int xmin = x0 + MIN(xi, 0) + MIN(yi, 0);
+        int ymin = y0 + MIN(xj, 0) + MIN(yj, 0);
+        if (xmin >= hc->width || ymin >= hc->height) {
+                return;         /* square lies wholly outside the grid */
+        }
+
+        int side = abs(xi) + abs(xj);
+        if (side == 1) {
+                hc->visit(xmin, ymin, hc->cl);
+                return;
+        }
+
+        int hxi = xi / 2, hxj = xj / 2;
+        int hyi = yi / 2, hyj = yj / 2;
+        walk(x0, y0, hyi, hyj, hxi, hxj, hc);
+        walk(x0 + hxi, y0 + hxj, hxi, hxj, hyi, hyj, hc);
+        walk(x0 + hxi + hyi, y0 + hxj + hyj, hxi, hxj, hyi, hyj, hc);
+        walk(x0 + hxi + yi, y0 + hxj + yj, -hyi, -hyj, -hxi, -hxj, hc);
+}
+
+/****************** Hilbert_map *******************
+ * 
+ * Calls visit on every point of a width x height grid in Hilbert-curve
+ * order.
+ *
+ * Parameters:
+ *      int width:              number of columns in the grid
+ *      int height:             number of rows in the grid
+ *      Hilbert_visitfun visit: function called once per point
+ *      void *cl:               closure passed through to visit
+ * Returns:
+ *      None
+ * Expects:
+ *      width >= 0, height >= 0 and visit is not NULL (throws a CRE
+ *      otherwise)
+ *
+ ********************************************/
+extern void Hilbert_map(int width, int height, Hilbert_visitfun visit,
+                        void *cl)
+{
+        assert(width >= 0 && height >= 0 && visit != NULL);
+        if (width == 0 || height == 0) {
+                return;
+        }
+
+        int side = 1;
+        while (side < width || side < height) {
+                side *= 2;
+        }
+        struct hilbert_closure hc = { width, height, visit, cl };
+        walk(0, 0, side, 0, 0, side, &hc);
+}
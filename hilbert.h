@@ -0,0 +1,27 @@
+/**************************************************************
+ *
+ *                     hilbert.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for walking a width x height grid along a Hilbert
+ *              curve. Consecutive points of the walk are always neighbours
+ *              on the grid, which keeps both the source and a rotated or
+ *              transposed destination local. Used by the map_hilbert
+ *              traversals of the A2Methods suites.
+ *              
+ **************************************************************/
+
+#ifndef HILBERT_INCLUDED
+#define HILBERT_INCLUDED
+
+typedef void Hilbert_visitfun(int x, int y, void *cl);
+
+/* calls visit(x, y, cl) once for every 0 <= x < width, 0 <= y < height,
+   in Hilbert-curve order over the enclosing power-of-two square */
+extern void Hilbert_map(int width, int height, Hilbert_visitfun visit,
+                        void *cl);
+
+#endif
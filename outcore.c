@@ -0,0 +1,239 @@
+/**************************************************************
+ *
+ *                     outcore.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the out-of-core transformation
+ *              engine. Under a transformation that exchanges the
+ *              dimensions, a horizontal strip of the source becomes a
+ *              vertical strip of the destination. So the source is read
+ *              one strip of B rows at a time into a UArray2b with B x B
+ *              blocks, and transformed in memory into a UArray2b that is
+ *              one block wide. Each of its blocks is one B x B tile of the
+ *              output, and is written to a scratch file that holds the
+ *              tiles in row-major order. A row of tiles is then contiguous
+ *              in the scratch file and has exactly the layout of a UArray2b
+ *              B rows high, so the output is assembled one such strip at a
+ *              time, with one large read each, and written out in order.
+ *              B is chosen so that a strip in either pass fits the memory
+ *              budget.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "assert.h"
+#include "except.h"
+#include "a2methods.h"
+#include "a2blocked.h"
+#include "uarray2b.h"
+#include "pixel.h"
+#include "ppmio.h"
+#include "cotrans.h"
+#include "outcore.h"
+
+/* smallest and largest tile side, whatever the budget */
+#define MIN_BLOCKSIZE 16
+#define MAX_BLOCKSIZE 4096
+
+const Except_T Outcore_Failed = { "Out-of-core scratch file I/O failed" };
+
+/****************** choose_blocksize *******************
+ *
+ * Picks the side of the tiles. A strip of the first pass needs its raster
+ * rows, the source strip and the transformed strip, about three copies of
+ * B rows of the source; a strip of the second pass needs two copies of B
+ * rows of the output. So B rows of the longer side, three times over, must
+ * fit the budget.
+ *
+ * Parameters:
+ *      size_t budget:     bytes of pixels to hold in memory at once
+ *      int width, height: dimensions of the source
+ *      int size:          bytes per cell
+ * Returns:
+ *      the tile side, no larger than the shorter side of the image
+ *
+ ********************************************/
+static int choose_blocksize(size_t budget, int width, int height, int size)
+{
+        size_t longer = width > height ? width : height;
+        size_t shorter = width > height ? height : width;
+        size_t blocksize = budget / (3 * longer * size);
+        if (blocksize < MIN_BLOCKSIZE) {
+                blocksize = MIN_BLOCKSIZE;
+        }
+        if (blocksize > MAX_BLOCKSIZE) {
+                blocksize = MAX_BLOCKSIZE;
+        }
+        if (blocksize > shorter) {
+                blocksize = shorter;
+        }
+        return blocksize;
+}
+
+/****************** open_scratch *******************
+ *
+ * Creates the scratch file in $TMPDIR, or /tmp, and unlinks it at once, so
+ * it disappears when closed however the program ends.
+ *
+ * Returns:
+ *      a descriptor open for reading and writing
+ * Expects:
+ *      The file can be created (raises Outcore_Failed if not)
+ *
+ ********************************************/
+static int open_scratch(void)
+{
+        const char *dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0') {
+                dir = "/tmp";
+        }
+        char path[4096];
+        if (snprintf(path, sizeof path, "%s/ppmtrans-XXXXXX", dir) >=
+            (int)sizeof path) {
+                RAISE(Outcore_Failed);
+        }
+        int fd = mkstemp(path);
+        if (fd < 0) {
+                RAISE(Outcore_Failed);
+        }
+        unlink(path);
+        return fd;
+}
+
+/****************** scratch_write *******************
+ *
+ * Writes n bytes to the scratch file at the given offset.
+ *
+ * Expects:
+ *      The write succeeds (raises Outcore_Failed if not)
+ *
+ ********************************************/
+static void scratch_write(int fd, const char *bytes, size_t n, off_t offset)
+{
+        while (n > 0) {
+                ssize_t done = pwrite(fd, bytes, n, offset);
+                if (done <= 0) {
+                        RAISE(Outcore_Failed);
+                }
+                bytes += done;
+                n -= done;
+                offset += done;
+        }
+}
+
+/****************** scratch_read *******************
+ *
+ * Reads n bytes from the scratch file at the given offset.
+ *
+ * Expects:
+ *      The read succeeds (raises Outcore_Failed if not)
+ *
+ ********************************************/
+static void scratch_read(int fd, char *bytes, size_t n, off_t offset)
+{
+        while (n > 0) {
+                ssize_t done = pread(fd, bytes, n, offset);
+                if (done <= 0) {
+                        RAISE(Outcore_Failed);
+                }
+                bytes += done;
+                n -= done;
+                offset += done;
+        }
+}
+
+/****************** Outcore_transform *******************
+ *
+ * Transforms an image in two passes over a scratch file of output tiles.
+ * Strips are cut so that each one becomes exactly one column of tiles:
+ * when the transformation sends source row r to output column r (270
+ * degrees, transpose), strips start at multiples of B from the top; when
+ * it sends it to column height - 1 - r (90 degrees, transverse), they
+ * start at multiples of B from the bottom, and the first strip holds the
+ * leftover rows. A strip is transformed with the cache-oblivious engine.
+ *
+ * Parameters:
+ *      FILE *in:            the file to read a P6 or P3 image from
+ *      FILE *out:           the file to write the transformed image to
+ *      D4_T t:              the transformation
+ *      size_t budget:       bytes of pixels to hold in memory at once
+ *      int *width, *height: set to the image's dimensions
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers are NULL and t exchanges the dimensions
+ *      (throws a CRE if not).
+ *      in holds a well-formed image (raises Pnm_Badformat if not), and
+ *      the scratch file can be written (raises Outcore_Failed if not).
+ *
+ ********************************************/
+void Outcore_transform(FILE *in, FILE *out, D4_T t, size_t budget,
+                       int *width, int *height)
+{
+        assert(in != NULL && out != NULL);
+        assert(width != NULL && height != NULL);
+        assert(D4_swaps_dimensions(t));
+        A2Methods_T methods = uarray2_methods_blocked;
+
+        struct Ppmio_header h;
+        Ppmio_read_header(in, &h);
+        int w = *width = h.width;
+        int ht = *height = h.height;
+        int size = Pixel_size(h.maxval);
+        int blocksize = choose_blocksize(budget, w, ht, size);
+        D4_map m = D4_affine(t, w, ht);
+
+        /* the output is ht wide and w high, in tiles of blocksize^2 */
+        int tile_cols = (ht + blocksize - 1) / blocksize;
+        int tile_rows = (w + blocksize - 1) / blocksize;
+        off_t tile_bytes = (off_t)blocksize * blocksize * size;
+        int fd = open_scratch();
+
+        /* first pass: strips of the source to columns of scratch tiles */
+        int nrows;
+        for (int r0 = 0; r0 < ht; r0 += nrows) {
+                nrows = m.xy > 0 ? ht - r0 : (ht - r0 - 1) % blocksize + 1;
+                if (nrows > blocksize) {
+                        nrows = blocksize;
+                }
+                int col0 = m.xy > 0 ? r0 : ht - r0 - nrows;
+                assert(col0 % blocksize == 0);
+
+                UArray2b_T src = UArray2b_new(w, nrows, size, blocksize);
+                Ppmio_read_rows(in, &h, methods, src);
+                UArray2b_T dst = UArray2b_new(nrows, w, size, blocksize);
+                CO_transform(methods, src, methods, dst, t);
+                UArray2b_free(&src);
+
+                int tile_col = col0 / blocksize;
+                for (int j = 0; j < tile_rows; j++) {
+                        scratch_write(fd, UArray2b_block(dst, 0, j),
+                                      tile_bytes,
+                                      ((off_t)j * tile_cols + tile_col) *
+                                      tile_bytes);
+                }
+                UArray2b_free(&dst);
+        }
+
+        /* second pass: each row of tiles is one strip of the output */
+        fprintf(out, "P6\n%d %d\n%u\n", ht, w, h.maxval);
+        for (int j = 0; j < tile_rows; j++) {
+                int rows = w - j * blocksize;
+                if (rows > blocksize) {
+                        rows = blocksize;
+                }
+                UArray2b_T strip = UArray2b_new(ht, rows, size, blocksize);
+                scratch_read(fd, UArray2b_block(strip, 0, 0),
+                             tile_cols * tile_bytes,
+                             (off_t)j * tile_cols * tile_bytes);
+                Ppmio_write_rows(out, methods, strip, h.maxval);
+                UArray2b_free(&strip);
+        }
+        close(fd);
+}
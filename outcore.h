@@ -0,0 +1,38 @@
+/**************************************************************
+ *
+ *                     outcore.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for the out-of-core transformation engine, which
+ *              applies the orientation changes that exchange the width and
+ *              height (90 and 270 degree rotations, transpose and
+ *              transverse) to images too large to hold in memory next to
+ *              their transformed copy. Only a few strips of the image are
+ *              ever in memory; the rest waits in a scratch file.
+ *
+ **************************************************************/
+
+#ifndef OUTCORE_INCLUDED
+#define OUTCORE_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "except.h"
+#include "d4.h"
+
+/* raised when the scratch file cannot be created, written or read */
+extern const Except_T Outcore_Failed;
+
+/* copies the P6 or P3 image in in to out as P6, applying t, which must
+   exchange the dimensions, while holding about budget bytes of pixels in
+   memory. The scratch file goes in $TMPDIR, or /tmp, and is removed when
+   done. Sets *width and *height to the size of the original image. Raises
+   Pnm_Badformat if in does not hold an image */
+extern void Outcore_transform(FILE *in, FILE *out, D4_T t, size_t budget,
+                              int *width, int *height);
+
+#endif
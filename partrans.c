@@ -0,0 +1,148 @@
+/**************************************************************
+ *
+ *                     partrans.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the multithreaded transformation
+ *              engine. Tiles are numbered in source storage order and run
+ *              as tasks on the shared work-stealing pool (workpool.c), so a
+ *              thread that finishes early takes tiles from the others. Each
+ *              tile is copied by the single-threaded engines: the tile-pair
+ *              engine for a run of blocks, or the cache-oblivious engine for
+ *              a square of pixels.
+ *              
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "assert.h"
+#include "a2methods.h"
+#include "uarray2b.h"
+#include "cotrans.h"
+#include "blocktrans.h"
+#include "workpool.h"
+#include "partrans.h"
+
+typedef A2Methods_UArray2 A2; /* private abbreviation */
+
+/* side of a square pixel tile: 128 x 128 pixels is 192KB, L2-sized */
+#define TILE_SIDE 128
+
+/* tiles per thread for runs of blocks, so that uneven progress evens out */
+#define TILES_PER_THREAD 16
+
+/********** par_job ********
+ * 
+ * One transformation shared by every thread: the arrays and how the source
+ * is cut into tiles.
+ *
+ *******************/
+struct par_job {
+        A2Methods_T methods, dst_methods;
+        A2 src, dst;
+        D4_T t;
+        bool pairs;          /* tiles are runs of blocks, not squares */
+        int width, height;   /* dimensions of src */
+        int ntiles;
+        int tiles_across;    /* square tiles per row of tiles */
+        int blocks_per_tile; /* for runs of blocks */
+        int nblocks;
+};
+
+/****************** copy_tile *******************
+ * 
+ * Transforms tile number i of the job's source. Run as a task of the pool.
+ *
+ * Parameters:
+ *      int i:    number of the tile
+ *      void *cl: the struct par_job of the transformation being performed
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      0 <= i < job->ntiles
+ *
+ ********************************************/
+static void copy_tile(int i, void *cl)
+{
+        struct par_job *job = cl;
+        if (job->pairs) {
+                int first = i * job->blocks_per_tile;
+                int count = job->blocks_per_tile;
+                if (first + count > job->nblocks) {
+                        count = job->nblocks - first;
+                }
+                Blocktrans_transform_blocks(job->src, job->dst, job->t,
+                                            first, count);
+        } else {
+                int c0 = (i % job->tiles_across) * TILE_SIDE;
+                int r0 = (i / job->tiles_across) * TILE_SIDE;
+                int c1 = (c0 + TILE_SIDE < job->width) ? c0 + TILE_SIDE
+                                                        : job->width;
+                int r1 = (r0 + TILE_SIDE < job->height) ? r0 + TILE_SIDE
+                                                         : job->height;
+                CO_transform_region(job->methods, job->src,
+                                    job->dst_methods, job->dst, job->t,
+                                    c0, r0, c1, r1);
+        }
+}
+
+/****************** Par_transform *******************
+ * 
+ * Copies every pixel of src to its transformed spot in dst with nthreads
+ * threads. The calling thread is one of them; the rest belong to the
+ * shared pool, which is started on first use and kept for later calls.
+ *
+ * Parameters:
+ *      A2Methods_T methods:     methods for src
+ *      A2 src:                  original array
+ *      A2Methods_T dst_methods: methods for dst
+ *      A2 dst:                  destination, of transformed dimensions
+ *      D4_T t:                  which transformation to perform
+ *      bool pairs:              cut into runs of blocks for the tile-pair
+ *                               engine
+ *      int nthreads:            number of threads to use
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers will be NULL and nthreads is positive (throws
+ *      a CRE otherwise). The requirements of the chosen engine hold.
+ *
+ ********************************************/
+extern void Par_transform(A2Methods_T methods, A2 src,
+                          A2Methods_T dst_methods, A2 dst, D4_T t,
+                          bool pairs, int nthreads)
+{
+        assert(methods != NULL && src != NULL);
+        assert(dst_methods != NULL && dst != NULL);
+        assert(nthreads > 0);
+        struct par_job job;
+        job.methods = methods;
+        job.dst_methods = dst_methods;
+        job.src = src;
+        job.dst = dst;
+        job.t = t;
+        job.pairs = pairs;
+        job.width = methods->width(src);
+        job.height = methods->height(src);
+
+        if (pairs) {
+                job.nblocks = Blocktrans_nblocks(src);
+                job.blocks_per_tile = job.nblocks /
+                                      (nthreads * TILES_PER_THREAD);
+                if (job.blocks_per_tile < 1) {
+                        job.blocks_per_tile = 1;
+                }
+                job.ntiles = (job.nblocks + job.blocks_per_tile - 1) /
+                             job.blocks_per_tile;
+        } else {
+                job.tiles_across = (job.width + TILE_SIDE - 1) / TILE_SIDE;
+                job.ntiles = job.tiles_across *
+                             ((job.height + TILE_SIDE - 1) / TILE_SIDE);
+        }
+
+        Workpool_run(Workpool_shared(nthreads), job.ntiles, copy_tile, &job);
+}
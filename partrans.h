@@ -0,0 +1,38 @@
+/**************************************************************
+ *
+ *                     partrans.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for the multithreaded transformation engine. The
+ *              source image is cut into tiles (runs of blocks for the
+ *              tile-pair engine) and the work-stealing pool transforms them
+ *              concurrently. Every transformation maps disjoint source
+ *              tiles to disjoint destination regions, so the threads need
+ *              no locking beyond handing out tiles. Used by the drivers
+ *              for ppmtrans -threads.
+ *              
+ **************************************************************/
+
+#ifndef PARTRANS_INCLUDED
+#define PARTRANS_INCLUDED
+
+#include <stdbool.h>
+
+#include "a2methods.h"
+#include "d4.h"
+
+/* copies every pixel of src to its spot in dst under transformation t,
+   using nthreads threads (the caller's included). With pairs set, the
+   arrays must be UArray2bs of the same blocksize and each thread uses the
+   tile-pair engine; otherwise each uses the cache-oblivious engine. dst
+   must already have the transformed dimensions, and both arrays must hold
+   cells of the same pixel.h format. src uses methods and dst uses
+   dst_methods */
+extern void Par_transform(A2Methods_T methods, A2Methods_UArray2 src,
+                          A2Methods_T dst_methods, A2Methods_UArray2 dst,
+                          D4_T t, bool pairs, int nthreads);
+
+#endif
@@ -0,0 +1,378 @@
+/**************************************************************
+ *
+ *                     pipeline.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the read/transform/write pipeline.
+ *              Run one after the other, the three steps leave the CPU idle
+ *              while a file is read or written and the disk idle while an
+ *              image is transformed. Here the reader and the writer each
+ *              have a thread, and the transformation runs in the caller's,
+ *              so the three overlap. Images travel between the stages in
+ *              frames, through queues. There are only PIPELINE_FRAMES
+ *              source frames and as many destination frames, and a stage
+ *              that has finished with one sends it back to the stage that
+ *              fills it, which then reuses its array. A stage that gets
+ *              ahead waits for a frame to come back, so no more than that
+ *              many images of each kind are ever in memory. Each frame
+ *              records when its image started to be read, so the writer
+ *              can report how long it took to get through.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "pnm.h"
+#include "transformations.h"
+#include "pipeline.h"
+
+/* frames of each kind: one in each of the two stages it passes between,
+   and one waiting in the queue between them */
+#define PIPELINE_FRAMES 3
+
+/* a queue can hold every frame, so adding to one never waits */
+#define QUEUE_SLOTS (2 * PIPELINE_FRAMES)
+
+/********** frame ********
+ *
+ * An image on its way through the pipeline, and the queue of free frames
+ * it goes back to once written. index is its place in the sequence, or -1
+ * for the frame that marks the end.
+ *
+ *******************/
+struct frame {
+        int index;
+        Pnm_ppm image;          /* NULL if it could not be read */
+        double started;         /* wall clock when reading it began */
+        struct queue *home;
+};
+
+/********** queue ********
+ *
+ * A first-in, first-out queue of frames, shared by two threads.
+ *
+ *******************/
+struct queue {
+        pthread_mutex_t lock;
+        pthread_cond_t nonempty;
+        struct frame *items[QUEUE_SLOTS];
+        int head, count;
+};
+
+/********** pipeline ********
+ *
+ * The stages' callbacks and the transformation, the queues between the
+ * stages and the frames. Each stage adds up the wall-clock time it spends
+ * working, and the writer the latency of each image, for the summary.
+ *
+ *******************/
+struct pipeline {
+        Pipeline_readfun *read;
+        Pipeline_writefun *write;
+        void *cl;
+        D4_T t;
+        A2Methods_T methods;
+        A2Methods_mapfun *map;
+        bool recursive;
+        int threads;
+
+        struct queue free_src;  /* source frames for the reader */
+        struct queue full_src;  /* read images for the transformation */
+        struct queue free_dst;  /* destination frames to transform into */
+        struct queue full_dst;  /* transformed images for the writer */
+        struct frame frames[2 * PIPELINE_FRAMES];
+
+        FILE *time_file;
+        double read_time, transform_time, write_time;
+        double total_latency, worst_latency;
+        int written;
+};
+
+/****************** queue_init *******************
+ *
+ * Makes a queue empty.
+ *
+ ********************************************/
+static void queue_init(struct queue *q)
+{
+        pthread_mutex_init(&q->lock, NULL);
+        pthread_cond_init(&q->nonempty, NULL);
+        q->head = 0;
+        q->count = 0;
+}
+
+/****************** queue_destroy *******************
+ *
+ * Releases a queue's lock and condition.
+ *
+ ********************************************/
+static void queue_destroy(struct queue *q)
+{
+        pthread_cond_destroy(&q->nonempty);
+        pthread_mutex_destroy(&q->lock);
+}
+
+/****************** queue_push *******************
+ *
+ * Adds a frame to the back of a queue, waking a thread waiting for one.
+ *
+ ********************************************/
+static void queue_push(struct queue *q, struct frame *f)
+{
+        pthread_mutex_lock(&q->lock);
+        assert(q->count < QUEUE_SLOTS);
+        q->items[(q->head + q->count) % QUEUE_SLOTS] = f;
+        q->count++;
+        pthread_cond_signal(&q->nonempty);
+        pthread_mutex_unlock(&q->lock);
+}
+
+/****************** queue_pop *******************
+ *
+ * Takes the frame at the front of a queue, waiting until there is one.
+ *
+ ********************************************/
+static struct frame *queue_pop(struct queue *q)
+{
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0) {
+                pthread_cond_wait(&q->nonempty, &q->lock);
+        }
+        struct frame *f = q->items[q->head];
+        q->head = (q->head + 1) % QUEUE_SLOTS;
+        q->count--;
+        pthread_mutex_unlock(&q->lock);
+        return f;
+}
+
+/****************** read_stage *******************
+ *
+ * Thread of the first stage: reads the images of the sequence into free
+ * source frames and passes them on, and passes on an end frame once the
+ * sequence ends.
+ *
+ ********************************************/
+static void *read_stage(void *cl)
+{
+        struct pipeline *p = cl;
+        bool more = true;
+        for (int k = 0; more; k++) {
+                struct frame *f = queue_pop(&p->free_src);
+                f->started = wall_clock();
+                more = p->read(k, &f->image, p->cl);
+                p->read_time += wall_clock() - f->started;
+                f->index = more ? k : -1;
+                queue_push(&p->full_src, f);
+        }
+        return NULL;
+}
+
+/****************** fit_destination *******************
+ *
+ * Gives a destination frame an array for the transformed image of src,
+ * keeping the one it has if it fits (see reuse_destination).
+ *
+ ********************************************/
+static void fit_destination(struct pipeline *p, struct frame *d,
+                            Pnm_ppm src)
+{
+        bool swaps = D4_swaps_dimensions(p->t);
+        unsigned width = swaps ? src->height : src->width;
+        unsigned height = swaps ? src->width : src->height;
+
+        if (d->image == NULL) {
+                NEW(d->image);
+                d->image->pixels = NULL;
+                d->image->methods = p->methods;
+        }
+        Pnm_ppm dst = d->image;
+        reuse_destination(p->methods, src->pixels, width, height,
+                          &dst->pixels);
+        dst->width = width;
+        dst->height = height;
+        dst->denominator = src->denominator;
+}
+
+/****************** transform_stage *******************
+ *
+ * The second stage, run by the caller: transforms each read image into a
+ * free destination frame and sends the source frame back to the reader.
+ * Under the identity, and for an image that could not be read, the source
+ * frame itself goes on to the writer, which sends it back once done.
+ *
+ ********************************************/
+static void transform_stage(struct pipeline *p)
+{
+        for (;;) {
+                struct frame *s = queue_pop(&p->full_src);
+                if (s->index < 0 || s->image == NULL ||
+                    p->t == D4_IDENTITY) {
+                        queue_push(&p->full_dst, s);
+                        if (s->index < 0) {
+                                return;
+                        }
+                        continue;
+                }
+
+                struct frame *d = queue_pop(&p->free_dst);
+                double start = wall_clock();
+                fit_destination(p, d, s->image);
+                copy_driver(p->t, p->methods, p->map, p->recursive,
+                            p->threads, s->image->pixels, p->methods,
+                            d->image->pixels, NULL);
+                d->index = s->index;
+                d->started = s->started;
+                p->transform_time += wall_clock() - start;
+
+                queue_push(&p->free_src, s);
+                queue_push(&p->full_dst, d);
+        }
+}
+
+/****************** write_stage *******************
+ *
+ * Thread of the last stage: writes the transformed images in order and
+ * sends each frame back to be filled again, until the end frame. The
+ * latency of an image runs from the start of its reading to the end of
+ * its writing, and is reported as each image goes out.
+ *
+ ********************************************/
+static void *write_stage(void *cl)
+{
+        struct pipeline *p = cl;
+        for (;;) {
+                struct frame *f = queue_pop(&p->full_dst);
+                if (f->index < 0) {
+                        queue_push(f->home, f);
+                        return NULL;
+                }
+                if (f->image != NULL) {
+                        double start = wall_clock();
+                        p->write(f->index, f->image, p->cl);
+                        double end = wall_clock();
+                        p->write_time += end - start;
+
+                        double latency = end - f->started;
+                        p->total_latency += latency;
+                        if (latency > p->worst_latency) {
+                                p->worst_latency = latency;
+                        }
+                        p->written++;
+                        if (p->time_file != NULL) {
+                                fprintf(p->time_file, "Latency of image %d: "
+                                        "%f nanoseconds\n", f->index,
+                                        latency);
+                        }
+                }
+                queue_push(f->home, f);
+        }
+}
+
+/****************** Pipeline_run *******************
+ *
+ * Reads, transforms and writes a sequence of images in three overlapping
+ * stages. The reader and the writer are threads of their own, started for
+ * the run; the transformation runs in the calling thread, and may use the
+ * shared work pool, as may the reader to decode. The reader can be
+ * PIPELINE_FRAMES images ahead of the transformation, and the
+ * transformation as many ahead of the writer.
+ *
+ * Parameters:
+ *      Pipeline_readfun *read:   reads image k of the sequence
+ *      Pipeline_writefun *write: writes transformed image k
+ *      void *cl:                 closure passed to read and write
+ *      D4_T t:                   the transformation
+ *      A2Methods_T methods:      methods of the images read
+ *      A2Methods_mapfun *map:    map function for the transformation
+ *      bool recursive:           use the cache-oblivious engine
+ *      int threads:              threads to transform each image with
+ *      FILE *time_file:          file for each image's latency and each
+ *                                stage's working time, or NULL
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers but cl and time_file are NULL, threads is
+ *      positive, and the stage threads can be started (throws a CRE if
+ *      not). An exception raised by read or write ends the program.
+ *
+ ********************************************/
+void Pipeline_run(Pipeline_readfun *read, Pipeline_writefun *write,
+                  void *cl, D4_T t, A2Methods_T methods,
+                  A2Methods_mapfun *map, bool recursive, int threads,
+                  FILE *time_file)
+{
+        assert(read != NULL && write != NULL);
+        assert(methods != NULL && map != NULL && threads > 0);
+
+        struct pipeline *p;
+        NEW(p);
+        p->read = read;
+        p->write = write;
+        p->cl = cl;
+        p->t = t;
+        p->methods = methods;
+        p->map = map;
+        p->recursive = recursive;
+        p->threads = threads;
+        p->time_file = time_file;
+        p->read_time = p->transform_time = p->write_time = 0;
+        p->total_latency = p->worst_latency = 0;
+        p->written = 0;
+        queue_init(&p->free_src);
+        queue_init(&p->full_src);
+        queue_init(&p->free_dst);
+        queue_init(&p->full_dst);
+        for (int k = 0; k < 2 * PIPELINE_FRAMES; k++) {
+                struct frame *f = &p->frames[k];
+                f->index = -1;
+                f->image = NULL;
+                f->home = k < PIPELINE_FRAMES ? &p->free_src : &p->free_dst;
+                queue_push(f->home, f);
+        }
+
+        pthread_t reader, writer;
+        int err = pthread_create(&reader, NULL, read_stage, p);
+        assert(err == 0);
+        err = pthread_create(&writer, NULL, write_stage, p);
+        assert(err == 0);
+        transform_stage(p);
+        pthread_join(reader, NULL);
+        pthread_join(writer, NULL);
+
+        if (time_file != NULL) {
+                fprintf(time_file, "Wall-clock time reading: %f "
+                                   "nanoseconds\n", p->read_time);
+                fprintf(time_file, "Wall-clock time transforming: %f "
+                                   "nanoseconds\n", p->transform_time);
+                fprintf(time_file, "Wall-clock time writing: %f "
+                                   "nanoseconds\n", p->write_time);
+                if (p->written > 0) {
+                        fprintf(time_file, "Mean latency: %f nanoseconds\n",
+                                p->total_latency / p->written);
+                        fprintf(time_file, "Worst latency: %f "
+                                           "nanoseconds\n",
+                                p->worst_latency);
+                }
+        }
+
+        /* every frame is home again; free what they still hold */
+        for (int k = 0; k < 2 * PIPELINE_FRAMES; k++) {
+                if (p->frames[k].image != NULL) {
+                        Pnm_ppmfree(&p->frames[k].image);
+                }
+        }
+        queue_destroy(&p->free_src);
+        queue_destroy(&p->full_src);
+        queue_destroy(&p->free_dst);
+        queue_destroy(&p->full_dst);
+        FREE(p);
+}
@@ -0,0 +1,49 @@
+/**************************************************************
+ *
+ *                     pipeline.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for a three-stage pipeline that transforms a
+ *              sequence of images: while image N is transformed, image
+ *              N + 1 is read and image N - 1 is written, each stage in its
+ *              own thread. A fixed set of images and output arrays is
+ *              passed from stage to stage and reused, so memory stays the
+ *              same however long the sequence is.
+ *
+ **************************************************************/
+
+#ifndef PIPELINE_INCLUDED
+#define PIPELINE_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+#include "pnm.h"
+#include "d4.h"
+
+/* reads image k of the sequence into *image. On entry *image is NULL or
+   an image from an earlier call, whose array may be reused or freed. Sets
+   *image to NULL if image k cannot be read, and returns false, leaving
+   *image alone, once the sequence has ended */
+typedef bool Pipeline_readfun(int k, Pnm_ppm *image, void *cl);
+
+/* writes the transformed image k of the sequence, which stays the
+   pipeline's */
+typedef void Pipeline_writefun(int k, Pnm_ppm image, void *cl);
+
+/* reads, transforms by t and writes every image of a sequence, in order,
+   the three steps overlapping from image to image. Images are read into
+   arrays made by methods, and transformed with threads threads. The
+   latency of each image, from the start of its reading to the end of its
+   writing, and the time each stage spent working go to time_file if it is
+   not NULL */
+extern void Pipeline_run(Pipeline_readfun *read, Pipeline_writefun *write,
+                         void *cl, D4_T t, A2Methods_T methods,
+                         A2Methods_mapfun *map, bool recursive, int threads,
+                         FILE *time_file);
+
+#endif
@@ -0,0 +1,68 @@
+/**************************************************************
+ *
+ *                     pixel.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: The cell formats pixel arrays are stored in. An image whose
+ *              maxval fits in a byte is stored packed, three bytes per
+ *              pixel, exactly as its P6 raster. A 16-bit image is stored in
+ *              six bytes per pixel, as native-endian 16-bit samples. The
+ *              wide struct Pnm_rgb of the course's Pnm_ppmread is still
+ *              accepted. An array's cell size tells the formats apart, so
+ *              the kernels need no other flag.
+ *              
+ **************************************************************/
+
+#ifndef PIXEL_INCLUDED
+#define PIXEL_INCLUDED
+
+#include <string.h>
+#include <stdint.h>
+
+#include "a2methods.h"
+#include "pnm.h"
+
+/* one 8-bit pixel, laid out as in a P6 raster: 3 bytes, byte-aligned */
+typedef struct Pixel_rgb8 {
+        unsigned char red, green, blue;
+} Pixel_rgb8;
+
+/* the packed layout relies on there being no padding */
+typedef char Pixel_rgb8_is_packed[sizeof(Pixel_rgb8) == 3 ? 1 : -1];
+
+/* one 16-bit pixel: 6 bytes, samples in native byte order */
+typedef struct Pixel_rgb16 {
+        uint16_t red, green, blue;
+} Pixel_rgb16;
+
+typedef char Pixel_rgb16_is_packed[sizeof(Pixel_rgb16) == 6 ? 1 : -1];
+
+/* the largest maxval stored as Pixel_rgb8 */
+#define PIXEL_RGB8_MAXVAL 255
+
+/* cell size to store pixels of the given maxval in */
+static inline int Pixel_size(unsigned maxval)
+{
+        return maxval <= PIXEL_RGB8_MAXVAL ? (int)sizeof(Pixel_rgb8)
+                                           : (int)sizeof(Pixel_rgb16);
+}
+
+/* copies one cell of the given size; the constant-size cases compile to
+   a couple of moves rather than a call to memcpy */
+static inline void Pixel_copy(void *dst, const void *src, int size)
+{
+        if (size == (int)sizeof(Pixel_rgb8)) {
+                *(Pixel_rgb8 *)dst = *(const Pixel_rgb8 *)src;
+        } else if (size == (int)sizeof(Pixel_rgb16)) {
+                *(Pixel_rgb16 *)dst = *(const Pixel_rgb16 *)src;
+        } else if (size == (int)sizeof(struct Pnm_rgb)) {
+                *(struct Pnm_rgb *)dst = *(const struct Pnm_rgb *)src;
+        } else {
+                memcpy(dst, src, size);
+        }
+}
+
+#endif
@@ -0,0 +1,540 @@
+/**************************************************************
+ *
+ *                     ppmbench.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Benchmark suite for the transformations. It sweeps every
+ *              orientation change over every array layout, traversal
+ *              order, blocksize, cell width and image size asked for, and
+ *              times each combination through copy_driver, the path the
+ *              batch, frame and server modes run, into a destination array
+ *              made beforehand, so only the transformation is timed. Each
+ *              combination is run a few times to warm the caches and then
+ *              timed over a number of repetitions, and the median, 90th
+ *              percentile and standard deviation of the nanoseconds per
+ *              pixel are written out as CSV or JSON, one row per
+ *              combination. It replaces the hand-run -time files of
+ *              performance_data.pdf, and `make bench` runs it.
+ *
+ *              Layouts and traversals come from tables. A new layout is
+ *              one more row: traversals it does not support, and
+ *              blocksizes it ignores, are skipped by asking its methods.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2morton.h"
+#include "pnm.h"
+#include "pixel.h"
+#include "d4.h"
+#include "transformations.h"
+#include "cputiming.h"
+
+typedef A2Methods_UArray2 A2; /* private abbreviation */
+
+/* most entries any list option takes */
+#define MAX_LIST 32
+
+/********** layout ********
+ *
+ * An array layout: its name and its methods.
+ *
+ *******************/
+static const struct layout {
+        const char *name;
+        A2Methods_T *methods;
+} layouts[] = {
+        { "plain",   &uarray2_methods_plain   },
+        { "blocked", &uarray2_methods_blocked },
+        { "morton",  &uarray2_methods_morton  },
+};
+
+/********** traversal ********
+ *
+ * A traversal order: the map function of the methods that gives it, and
+ * whether the cache-oblivious engine runs instead, as with -recursive.
+ *
+ *******************/
+static const struct traversal {
+        const char *name;
+        size_t map;             /* offset of the map in the methods */
+        bool recursive;
+} traversals[] = {
+        { "row-major",   offsetof(struct A2Methods_T, map_row_major),   false },
+        { "col-major",   offsetof(struct A2Methods_T, map_col_major),   false },
+        { "block-major", offsetof(struct A2Methods_T, map_block_major), false },
+        { "default",     offsetof(struct A2Methods_T, map_default),     false },
+        { "hilbert",     offsetof(struct A2Methods_T, map_hilbert),     false },
+        { "recursive",   offsetof(struct A2Methods_T, map_default),     true  },
+};
+
+/* names of the transformations, in the order of D4_T */
+static const char *transform_names[] = {
+        "identity", "rotate-90", "rotate-180", "rotate-270",
+        "flip-horizontal", "flip-vertical", "transpose", "transverse"
+};
+
+#define NELEMS(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+/********** settings ********
+ *
+ * What to sweep and how to time it, from the command line.
+ *
+ *******************/
+struct settings {
+        int widths[MAX_LIST], heights[MAX_LIST], nsizes;
+        int blocksizes[MAX_LIST], nblocksizes;  /* 0 for the default */
+        int cells[MAX_LIST], ncells;
+        int warmup, reps, threads;
+        bool json;
+};
+
+/****************** usage *******************
+ *
+ * Prints how to run the program and exits.
+ *
+ ********************************************/
+static void usage(const char *progname)
+{
+        fprintf(stderr, "Usage: %s [-reps <n>] [-warmup <n>] "
+                        "[-sizes WxH,...] [-blocksizes n,...] "
+                        "[-cells {3,6,12},...] [-threads <n>] [-json]\n",
+                        progname);
+        exit(1);
+}
+
+/****************** parse_list *******************
+ *
+ * Parses a comma-separated list of positive numbers, or of WxH pairs
+ * when second is not NULL.
+ *
+ * Parameters:
+ *      const char *arg: the list
+ *      int *first:      set to the numbers, or the widths
+ *      int *second:     set to the heights, or NULL
+ * Returns:
+ *      the number of entries, or -1 if the list is malformed
+ *
+ ********************************************/
+static int parse_list(const char *arg, int *first, int *second)
+{
+        int n = 0;
+        const char *p = arg;
+        for (;;) {
+                char *end;
+                long a = strtol(p, &end, 10);
+                long b = 1;
+                if (end == p || a < 0 || a > 65536 || n == MAX_LIST) {
+                        return -1;
+                }
+                if (second != NULL) {
+                        if (*end != 'x' || a == 0) {
+                                return -1;
+                        }
+                        p = end + 1;
+                        b = strtol(p, &end, 10);
+                        if (end == p || b <= 0 || b > 65536) {
+                                return -1;
+                        }
+                        second[n] = b;
+                }
+                first[n++] = a;
+                if (*end == '\0') {
+                        return n;
+                }
+                if (*end != ',') {
+                        return -1;
+                }
+                p = end + 1;
+        }
+}
+
+/****************** positive *******************
+ *
+ * Parses the number following an option, or exits with the usage.
+ *
+ ********************************************/
+static int positive(int argc, char *argv[], int *i, int least)
+{
+        if (!(*i + 1 < argc)) {
+                usage(argv[0]);
+        }
+        char *end;
+        long n = strtol(argv[++*i], &end, 10);
+        if (*end != '\0' || n < least || n > 1000000) {
+                usage(argv[0]);
+        }
+        return n;
+}
+
+/****************** parse_settings *******************
+ *
+ * Reads the command line. By default, every transformation is timed over
+ * three sizes, two of them not multiples of any blocksize, in 3-byte
+ * cells, with blocksizes of 16, 64 and the default, after one warm-up
+ * run, over five repetitions, on one thread.
+ *
+ ********************************************/
+static void parse_settings(int argc, char *argv[], struct settings *s)
+{
+        static const int widths[] = { 64, 255, 1000 };
+        static const int heights[] = { 64, 255, 777 };
+        s->nsizes = NELEMS(widths);
+        memcpy(s->widths, widths, sizeof widths);
+        memcpy(s->heights, heights, sizeof heights);
+        s->blocksizes[0] = 0;
+        s->blocksizes[1] = 16;
+        s->blocksizes[2] = 64;
+        s->nblocksizes = 3;
+        s->cells[0] = sizeof(Pixel_rgb8);
+        s->ncells = 1;
+        s->warmup = 1;
+        s->reps = 5;
+        s->threads = 1;
+        s->json = false;
+
+        for (int i = 1; i < argc; i++) {
+                if (strcmp(argv[i], "-reps") == 0) {
+                        s->reps = positive(argc, argv, &i, 1);
+                } else if (strcmp(argv[i], "-warmup") == 0) {
+                        s->warmup = positive(argc, argv, &i, 0);
+                } else if (strcmp(argv[i], "-threads") == 0) {
+                        s->threads = positive(argc, argv, &i, 1);
+                } else if (strcmp(argv[i], "-json") == 0) {
+                        s->json = true;
+                } else if (strcmp(argv[i], "-sizes") == 0 && i + 1 < argc) {
+                        s->nsizes = parse_list(argv[++i], s->widths,
+                                               s->heights);
+                        if (s->nsizes < 0) {
+                                usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-blocksizes") == 0 &&
+                           i + 1 < argc) {
+                        s->nblocksizes = parse_list(argv[++i], s->blocksizes,
+                                                    NULL);
+                        if (s->nblocksizes < 0) {
+                                usage(argv[0]);
+                        }
+                } else if (strcmp(argv[i], "-cells") == 0 && i + 1 < argc) {
+                        s->ncells = parse_list(argv[++i], s->cells, NULL);
+                        if (s->ncells < 0) {
+                                usage(argv[0]);
+                        }
+                        for (int k = 0; k < s->ncells; k++) {
+                                if (s->cells[k] != sizeof(Pixel_rgb8) &&
+                                    s->cells[k] != sizeof(Pixel_rgb16) &&
+                                    s->cells[k] != sizeof(struct Pnm_rgb)) {
+                                        usage(argv[0]);
+                                }
+                        }
+                } else {
+                        usage(argv[0]);
+                }
+        }
+}
+
+/****************** fill_cell *******************
+ *
+ * Apply function giving every byte of a cell a value that depends on its
+ * place, so the source is neither zero pages nor all alike.
+ *
+ ********************************************/
+static void fill_cell(int col, int row, A2 array, void *elem, void *cl)
+{
+        (void) array;
+        int size = *(int *)cl;
+        unsigned char *bytes = elem;
+        for (int k = 0; k < size; k++) {
+                bytes[k] = (unsigned char)(col * 31 + row * 17 + k);
+        }
+}
+
+/****************** compare_doubles *******************
+ *
+ * qsort comparison putting numbers in increasing order.
+ *
+ ********************************************/
+static int compare_doubles(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+/********** stats ********
+ *
+ * Summary of the nanoseconds per pixel of a combination's repetitions.
+ *
+ *******************/
+struct stats {
+        double median, p90, stddev, cpu_median;
+};
+
+/****************** median *******************
+ *
+ * Returns the median of n sorted numbers.
+ *
+ ********************************************/
+static double median(const double *sorted, int n)
+{
+        return n % 2 == 1 ? sorted[n / 2]
+                          : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+/****************** summarize *******************
+ *
+ * Computes the statistics of a combination's repetitions: the median,
+ * the 90th percentile (nearest rank) and the sample standard deviation
+ * of the wall-clock times, and the median of the CPU times. Sorts both
+ * arrays.
+ *
+ ********************************************/
+static struct stats summarize(double *wall, double *cpu, int n)
+{
+        struct stats st;
+        qsort(wall, n, sizeof *wall, compare_doubles);
+        qsort(cpu, n, sizeof *cpu, compare_doubles);
+        st.median = median(wall, n);
+        st.cpu_median = median(cpu, n);
+        int rank = (int)ceil(0.9 * n);
+        st.p90 = wall[rank > 0 ? rank - 1 : 0];
+
+        double mean = 0;
+        for (int k = 0; k < n; k++) {
+                mean += wall[k];
+        }
+        mean /= n;
+        double squares = 0;
+        for (int k = 0; k < n; k++) {
+                squares += (wall[k] - mean) * (wall[k] - mean);
+        }
+        st.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0;
+        return st;
+}
+
+/****************** print_row *******************
+ *
+ * Writes one combination's results, as a CSV line or a JSON object.
+ *
+ ********************************************/
+static void print_row(const struct settings *s, bool first, D4_T t,
+                      const char *layout, const char *traversal,
+                      int blocksize, int cell, int width, int height,
+                      struct stats st)
+{
+        if (s->json) {
+                printf("%s\n  {\"transform\": \"%s\", \"layout\": \"%s\", "
+                       "\"traversal\": \"%s\", \"blocksize\": %d, "
+                       "\"cell_bytes\": %d, \"width\": %d, \"height\": %d, "
+                       "\"threads\": %d, \"reps\": %d, "
+                       "\"median_ns_per_pixel\": %.4f, "
+                       "\"p90_ns_per_pixel\": %.4f, "
+                       "\"stddev_ns_per_pixel\": %.4f, "
+                       "\"cpu_median_ns_per_pixel\": %.4f}",
+                       first ? "" : ",", transform_names[t], layout,
+                       traversal, blocksize, cell, width, height,
+                       s->threads, s->reps, st.median, st.p90, st.stddev,
+                       st.cpu_median);
+        } else {
+                printf("%s,%s,%s,%d,%d,%d,%d,%d,%d,%.4f,%.4f,%.4f,%.4f\n",
+                       transform_names[t], layout, traversal, blocksize,
+                       cell, width, height, s->threads, s->reps, st.median,
+                       st.p90, st.stddev, st.cpu_median);
+        }
+        fflush(stdout);
+}
+
+/****************** time_transform *******************
+ *
+ * Times one transformation of one source array in one traversal: the
+ * warm-up runs, then the timed repetitions, each into the same
+ * destination array.
+ *
+ * Parameters:
+ *      const struct settings *s: the settings
+ *      A2Methods_T methods:      methods of the arrays
+ *      A2Methods_mapfun *map:    the traversal's map function
+ *      bool recursive:           use the cache-oblivious engine
+ *      D4_T t:                   the transformation
+ *      A2 src:                   the source array
+ *      A2 *dst:                  the destination array, kept between
+ *                                calls (see reuse_destination)
+ * Returns:
+ *      the statistics of the repetitions, in nanoseconds per pixel
+ *
+ ********************************************/
+static struct stats time_transform(const struct settings *s,
+                                   A2Methods_T methods,
+                                   A2Methods_mapfun *map, bool recursive,
+                                   D4_T t, A2 src, A2 *dst)
+{
+        int width = methods->width(src);
+        int height = methods->height(src);
+        double pixels = (double)width * height;
+        bool swaps = D4_swaps_dimensions(t);
+        A2 out = reuse_destination(methods, src, swaps ? height : width,
+                                   swaps ? width : height, dst);
+
+        double *wall = CALLOC(s->reps, sizeof *wall);
+        double *cpu = CALLOC(s->reps, sizeof *cpu);
+        CPUTime_T timer = CPUTime_New();
+        for (int k = -s->warmup; k < s->reps; k++) {
+                CPUTime_Start(timer);
+                double start = wall_clock();
+                copy_driver(t, methods, map, recursive, s->threads, src,
+                            methods, out, NULL);
+                double wall_time = wall_clock() - start;
+                double cpu_time = CPUTime_Stop(timer);
+                if (k >= 0) {
+                        wall[k] = wall_time / pixels;
+                        cpu[k] = cpu_time / pixels;
+                }
+        }
+        CPUTime_Free(&timer);
+
+        struct stats st = summarize(wall, cpu, s->reps);
+        FREE(wall);
+        FREE(cpu);
+        return st;
+}
+
+/****************** map_of *******************
+ *
+ * Returns the map function a traversal uses in a layout, or NULL if the
+ * layout has none.
+ *
+ ********************************************/
+static A2Methods_mapfun *map_of(A2Methods_T methods,
+                                const struct traversal *tr)
+{
+        return *(A2Methods_mapfun *const *)((const char *)methods + tr->map);
+}
+
+/****************** sweep_layout *******************
+ *
+ * Times every transformation in one layout, for one size and cell width:
+ * for each blocksize it makes one source array and times each traversal
+ * the layout supports. A blocksize the layout ignores, giving the same
+ * array as one already timed, is skipped, as is a traversal whose map is
+ * the same function as an earlier one's.
+ *
+ * Parameters:
+ *      const struct settings *s:   the settings
+ *      const struct layout *l:     the layout
+ *      int width, height, cell:    size of the arrays and of their cells
+ *      bool *first:                true until a result has been printed
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void sweep_layout(const struct settings *s, const struct layout *l,
+                         int width, int height, int cell, bool *first)
+{
+        A2Methods_T methods = *l->methods;
+        int done[MAX_LIST];             /* blocksizes already timed */
+        int ndone = 0;
+
+        for (int b = 0; b < s->nblocksizes; b++) {
+                A2 src = s->blocksizes[b] > 0 ?
+                        methods->new_with_blocksize(width, height, cell,
+                                                    s->blocksizes[b]) :
+                        methods->new(width, height, cell);
+                int blocksize = methods->blocksize(src);
+                bool seen = false;
+                for (int k = 0; k < ndone; k++) {
+                        seen = seen || done[k] == blocksize;
+                }
+                if (seen) {
+                        methods->free(&src);
+                        continue;
+                }
+                done[ndone++] = blocksize;
+                methods->map_default(src, fill_cell, &cell);
+
+                A2 dst = NULL;
+                for (int v = 0; v < NELEMS(traversals); v++) {
+                        const struct traversal *tr = &traversals[v];
+                        A2Methods_mapfun *map = map_of(methods, tr);
+                        bool repeated = false;
+                        for (int u = 0; u < v && !tr->recursive; u++) {
+                                repeated = repeated ||
+                                        (!traversals[u].recursive &&
+                                         map_of(methods, &traversals[u]) ==
+                                         map);
+                        }
+                        if (map == NULL || repeated) {
+                                continue;
+                        }
+                        for (int t = 0; t < NELEMS(transform_names); t++) {
+                                struct stats st = time_transform(
+                                        s, methods, map, tr->recursive,
+                                        (D4_T)t, src, &dst);
+                                print_row(s, *first, (D4_T)t, l->name,
+                                          tr->name, blocksize, cell, width,
+                                          height, st);
+                                *first = false;
+                        }
+                }
+                if (dst != NULL) {
+                        methods->free(&dst);
+                }
+                methods->free(&src);
+        }
+}
+
+/****************** main *******************
+ *
+ * Runs the sweep over every size, cell width and layout, writing the
+ * results to stdout.
+ *
+ * Parameters:
+ *      int argc:     number of arguments
+ *      char *argv[]: the arguments, see usage
+ * Returns:
+ *      EXIT_SUCCESS
+ *
+ ********************************************/
+int main(int argc, char *argv[])
+{
+        struct settings s;
+        parse_settings(argc, argv, &s);
+
+        if (s.json) {
+                printf("[");
+        } else {
+                printf("transform,layout,traversal,blocksize,cell_bytes,"
+                       "width,height,threads,reps,median_ns_per_pixel,"
+                       "p90_ns_per_pixel,stddev_ns_per_pixel,"
+                       "cpu_median_ns_per_pixel\n");
+        }
+
+        bool first = true;
+        for (int z = 0; z < s.nsizes; z++) {
+                for (int c = 0; c < s.ncells; c++) {
+                        for (int l = 0; l < NELEMS(layouts); l++) {
+                                sweep_layout(&s, &layouts[l], s.widths[z],
+                                             s.heights[z], s.cells[c],
+                                             &first);
+                        }
+                }
+        }
+
+        if (s.json) {
+                printf("\n]\n");
+        }
+        return EXIT_SUCCESS;
+}
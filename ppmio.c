@@ -0,0 +1,1757 @@
+/**************************************************************
+ *
+ *                     ppmio.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the PPM reader and writer. Both go
+ *              through a P6 raster in memory: the reader loads (or, for
+ *              P3, builds) the raster and then scatters it into the array.
+ *              The writer serializes the array a row, or a row of blocks,
+ *              at a time into a large buffer and writes it with writev;
+ *              rows of packed 8-bit cells, which already have the
+ *              raster's layout, are written from the array itself. When
+ *              the methods provide map_spans, a whole run of cells is moved
+ *              at once, which for packed 8-bit cells is a plain memcpy.
+ *              
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "assert.h"
+#include "except.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "uarray2.h"
+#include "uarray2b.h"
+#include "pnm.h"
+#include "pixel.h"
+#include "d4.h"
+#include "workpool.h"
+#include "ppmio.h"
+
+typedef A2Methods_UArray2 A2; /* private abbreviation */
+
+/* rows a streamed image is moved in, at least one per chunk */
+#define STREAM_BYTES (64 * 1024)
+
+/* bytes the writer serializes before each write, at least one strip */
+#define WRITE_BYTES (1024 * 1024)
+
+/* pieces of output handed to one writev; POSIX allows at least 16 and
+   Linux 1024 */
+#define WRITE_PIECES 256
+
+/* the writer's buffer starts on a page boundary */
+#define WRITE_ALIGN 4096
+
+/* bands of rows (or chunks of P3 text) per decoding thread, so that
+   uneven progress evens out */
+#define BANDS_PER_THREAD 4
+
+/* threads that decode an image, see Ppmio_set_threads */
+static int decode_threads = 1;
+
+/********** raster ********
+ * 
+ * A P6 raster in memory, and the format of the array cells it is being
+ * moved to or from.
+ *
+ *******************/
+struct raster {
+        unsigned char *bytes;
+        int width;
+        unsigned maxval;  /* largest sample */
+        int sample_bytes; /* 1 if maxval <= 255, else 2 (big-endian) */
+        int pixel_bytes;  /* 3 * sample_bytes */
+        int cell_size;    /* size of an array cell, see pixel.h */
+        int row0;         /* image row held in the first row of bytes */
+};
+
+/********** writer ********
+ * 
+ * Output queued for writev: pieces of memory to be written in order. A
+ * piece is either memory the caller already has in file order, such as a
+ * row of packed 8-bit cells, which is written where it lies, or a run
+ * serialized into the writer's own buffer. Adjacent pieces are merged, so
+ * a contiguous raster goes out in a single piece.
+ *
+ *******************/
+struct writer {
+        FILE *fp;
+        int fd;                 /* fp's descriptor, or -1 to use fwrite */
+        void *slab;             /* memory returned by ALLOC */
+        unsigned char *buf;     /* slab, aligned to WRITE_ALIGN */
+        size_t used, capacity;  /* bytes of buf in use, and in all */
+        struct iovec pieces[WRITE_PIECES];
+        int npieces;
+};
+
+/****************** skip_space *******************
+ * 
+ * Skips whitespace and comments (from '#' to the end of the line).
+ *
+ * Parameters:
+ *      FILE *fp: the file being read
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      fp is not NULL
+ *
+ ********************************************/
+static void skip_space(FILE *fp)
+{
+        int c;
+        while ((c = getc(fp)) != EOF) {
+                if (c == '#') {
+                        while ((c = getc(fp)) != EOF && c != '\n') {
+                        }
+                } else if (c != ' ' && c != '\t' && c != '\n' &&
+                           c != '\r' && c != '\v' && c != '\f') {
+                        ungetc(c, fp);
+                        return;
+                }
+        }
+}
+
+/****************** scan_number *******************
+ * 
+ * Reads a decimal number, after any whitespace and comments.
+ *
+ * Parameters:
+ *      FILE *fp:    the file being read
+ *      unsigned *n: set to the number read
+ * Returns:
+ *      true, or false if what comes next is not a number of at most 65535
+ * Expects:
+ *      fp is not NULL
+ *
+ ********************************************/
+static bool scan_number(FILE *fp, unsigned *n)
+{
+        skip_space(fp);
+        int c = getc(fp);
+        if (c < '0' || c > '9') {
+                return false;
+        }
+        *n = 0;
+        for (; c >= '0' && c <= '9'; c = getc(fp)) {
+                *n = *n * 10 + (c - '0');
+                if (*n > 65535) {
+                        return false;
+                }
+        }
+        ungetc(c, fp);
+        return true;
+}
+
+/****************** decode_cell *******************
+ * 
+ * Stores one pixel of the raster in a wide struct Pnm_rgb cell, the
+ * format of the course's Pnm_ppmread.
+ *
+ * Parameters:
+ *      struct raster *r:        the raster's format
+ *      const unsigned char *in: the pixel in the raster
+ *      struct Pnm_rgb *cell:    the cell to fill in
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers are NULL
+ *
+ ********************************************/
+static void decode_cell(struct raster *r, const unsigned char *in,
+                        struct Pnm_rgb *cell)
+{
+        unsigned v[3];
+        for (int k = 0; k < 3; k++) {
+                if (r->sample_bytes == 1) {
+                        v[k] = in[k];
+                } else {
+                        v[k] = (in[2 * k] << 8) | in[2 * k + 1];
+                }
+        }
+        cell->red = v[0];
+        cell->green = v[1];
+        cell->blue = v[2];
+}
+
+/****************** encode_cell *******************
+ * 
+ * Stores a wide struct Pnm_rgb cell as one pixel of the raster.
+ *
+ * Parameters:
+ *      struct raster *r:           the raster's format
+ *      const struct Pnm_rgb *cell: the cell to store
+ *      unsigned char *out:         the pixel in the raster
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers are NULL
+ *
+ ********************************************/
+static void encode_cell(struct raster *r, const struct Pnm_rgb *cell,
+                        unsigned char *out)
+{
+        unsigned v[3] = { cell->red, cell->green, cell->blue };
+        for (int k = 0; k < 3; k++) {
+                if (r->sample_bytes == 1) {
+                        out[k] = v[k];
+                } else {
+                        out[2 * k] = v[k] >> 8;
+                        out[2 * k + 1] = v[k] & 0xff;
+                }
+        }
+}
+
+/****************** scatter_span *******************
+ * 
+ * Span function that fills a run of len cells from the matching pixels of
+ * the raster.
+ *
+ * Parameters:
+ *      int col, row:  coordinates of the first cell of the run
+ *      int len:       number of cells in the run
+ *      A2 array:      the array being filled
+ *      void *span:    the first cell of the run
+ *      void *cl:      the struct raster
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void scatter_span(int col, int row, int len, A2 array, void *span,
+                         void *cl)
+{
+        (void) array;
+        struct raster *r = cl;
+        const unsigned char *in = r->bytes + 
+                                  ((long)(row - r->row0) * r->width + col) *
+                                  r->pixel_bytes;
+        if (r->cell_size == (int)sizeof(Pixel_rgb8)) {
+                memcpy(span, in, (size_t)len * sizeof(Pixel_rgb8));
+                return;
+        }
+        if (r->cell_size == (int)sizeof(Pixel_rgb16)) {
+                /* 16-bit samples are big-endian in the raster */
+                Pixel_rgb16 *px = span;
+                for (int k = 0; k < len; k++, in += 6) {
+                        px[k].red   = (in[0] << 8) | in[1];
+                        px[k].green = (in[2] << 8) | in[3];
+                        px[k].blue  = (in[4] << 8) | in[5];
+                }
+                return;
+        }
+        assert(r->cell_size == (int)sizeof(struct Pnm_rgb));
+        struct Pnm_rgb *cells = span;
+        for (int k = 0; k < len; k++, in += r->pixel_bytes) {
+                decode_cell(r, in, &cells[k]);
+        }
+}
+
+/****************** scatter_cell *******************
+ * 
+ * Apply function version of scatter_span, for methods without map_spans.
+ *
+ ********************************************/
+static void scatter_cell(int col, int row, A2 array, void *elem, void *cl)
+{
+        scatter_span(col, row, 1, array, elem, cl);
+}
+
+/****************** gather_span *******************
+ * 
+ * Span function that copies a run of len cells to the matching pixels of
+ * the raster.
+ *
+ * Parameters:
+ *      int col, row:  coordinates of the first cell of the run
+ *      int len:       number of cells in the run
+ *      A2 array:      the array being written out
+ *      void *span:    the first cell of the run
+ *      void *cl:      the struct raster
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void gather_span(int col, int row, int len, A2 array, void *span,
+                        void *cl)
+{
+        (void) array;
+        struct raster *r = cl;
+        unsigned char *out = r->bytes + 
+                             ((long)(row - r->row0) * r->width + col) *
+                             r->pixel_bytes;
+        if (r->cell_size == (int)sizeof(Pixel_rgb8)) {
+                memcpy(out, span, (size_t)len * sizeof(Pixel_rgb8));
+                return;
+        }
+        if (r->cell_size == (int)sizeof(Pixel_rgb16)) {
+                const Pixel_rgb16 *px = span;
+                for (int k = 0; k < len; k++, out += 6) {
+                        out[0] = px[k].red >> 8;
+                        out[1] = px[k].red & 0xff;
+                        out[2] = px[k].green >> 8;
+                        out[3] = px[k].green & 0xff;
+                        out[4] = px[k].blue >> 8;
+                        out[5] = px[k].blue & 0xff;
+                }
+                return;
+        }
+        assert(r->cell_size == (int)sizeof(struct Pnm_rgb));
+        const struct Pnm_rgb *cells = span;
+        for (int k = 0; k < len; k++, out += r->pixel_bytes) {
+                encode_cell(r, &cells[k], out);
+        }
+}
+
+/****************** gather_cell *******************
+ * 
+ * Apply function version of gather_span, for methods without map_spans.
+ *
+ ********************************************/
+static void gather_cell(int col, int row, A2 array, void *elem, void *cl)
+{
+        gather_span(col, row, 1, array, elem, cl);
+}
+
+/****************** scan_plain_raster *******************
+ * 
+ * Builds a P6 raster from the ASCII samples of a P3 image.
+ *
+ * Parameters:
+ *      FILE *fp:         positioned at the first sample
+ *      struct raster *r: the raster to fill, of nsamples samples
+ *      long nsamples:    number of samples to read
+ * Returns:
+ *      true, or false if fp holds fewer than nsamples numbers or one
+ *      above the raster's maxval
+ *
+ ********************************************/
+static bool scan_plain_raster(FILE *fp, struct raster *r, long nsamples)
+{
+        unsigned char *out = r->bytes;
+        for (long k = 0; k < nsamples; k++) {
+                unsigned v;
+                if (!scan_number(fp, &v) || v > r->maxval) {
+                        return false;
+                }
+                if (r->sample_bytes == 2) {
+                        *out++ = v >> 8;
+                }
+                *out++ = v & 0xff;
+        }
+        return true;
+}
+
+/****************** read_plain_raster *******************
+ * 
+ * Builds a P6 raster from the ASCII samples of a P3 image, as
+ * scan_plain_raster does.
+ *
+ * Expects:
+ *      fp holds nsamples numbers, none above the raster's maxval (raises
+ *      Pnm_Badformat otherwise)
+ *
+ ********************************************/
+static void read_plain_raster(FILE *fp, struct raster *r, long nsamples)
+{
+        if (!scan_plain_raster(fp, r, nsamples)) {
+                RAISE(Pnm_Badformat);
+        }
+}
+
+/****************** writer_init *******************
+ * 
+ * Sets up a writer for a file, with a buffer of at least WRITE_BYTES.
+ * Anything fp has buffered is flushed first, since the writer writes to
+ * the descriptor underneath it.
+ *
+ * Parameters:
+ *      struct writer *w: the writer
+ *      FILE *fp:         the file to write to
+ *      size_t capacity:  the longest run that will be serialized at once
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void writer_init(struct writer *w, FILE *fp, size_t capacity)
+{
+        fflush(fp);
+        w->fp = fp;
+        w->fd = fileno(fp);
+        w->capacity = capacity > WRITE_BYTES ? capacity : WRITE_BYTES;
+        w->slab = ALLOC(w->capacity + WRITE_ALIGN - 1);
+        w->buf = (unsigned char *)(((uintptr_t)w->slab + WRITE_ALIGN - 1) &
+                                   ~(uintptr_t)(WRITE_ALIGN - 1));
+        w->used = 0;
+        w->npieces = 0;
+}
+
+/****************** writer_flush *******************
+ * 
+ * Writes every queued piece, with as few writev calls as the kernel
+ * allows, and empties the buffer. A file with no descriptor (a memory
+ * stream, say) gets the pieces through fwrite instead.
+ *
+ * Parameters:
+ *      struct writer *w: the writer
+ * Returns:
+ *      Nothing; like fwrite before it, a failed write is not reported
+ *
+ ********************************************/
+static void writer_flush(struct writer *w)
+{
+        struct iovec *piece = w->pieces;
+        int n = w->npieces;
+        while (n > 0) {
+                if (w->fd < 0) {
+                        fwrite(piece->iov_base, 1, piece->iov_len, w->fp);
+                        piece++;
+                        n--;
+                        continue;
+                }
+                ssize_t done = writev(w->fd, piece, n);
+                if (done < 0 && errno == EINTR) {
+                        continue;
+                }
+                if (done <= 0) {
+                        break;
+                }
+                /* skip what was written, which may end inside a piece */
+                while (n > 0 && (size_t)done >= piece->iov_len) {
+                        done -= piece->iov_len;
+                        piece++;
+                        n--;
+                }
+                if (n > 0) {
+                        piece->iov_base = (char *)piece->iov_base + done;
+                        piece->iov_len -= done;
+                }
+        }
+        w->npieces = 0;
+        w->used = 0;
+}
+
+/****************** writer_add *******************
+ * 
+ * Queues n bytes that are already in file order, to be written from
+ * where they lie. They must stay unchanged until the next flush.
+ *
+ * Parameters:
+ *      struct writer *w:  the writer
+ *      const void *bytes: the bytes to write
+ *      size_t n:          how many
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void writer_add(struct writer *w, const void *bytes, size_t n)
+{
+        if (w->npieces > 0) {
+                struct iovec *last = &w->pieces[w->npieces - 1];
+                if ((const char *)last->iov_base + last->iov_len == bytes) {
+                        last->iov_len += n;
+                        return;
+                }
+        }
+        if (w->npieces == WRITE_PIECES) {
+                writer_flush(w);
+        }
+        w->pieces[w->npieces].iov_base = (void *)bytes;
+        w->pieces[w->npieces].iov_len = n;
+        w->npieces++;
+}
+
+/****************** writer_reserve *******************
+ * 
+ * Returns room for n bytes in the writer's buffer, flushing it first if
+ * it is too full. The caller serializes into the room and then queues it
+ * with writer_commit.
+ *
+ * Parameters:
+ *      struct writer *w: the writer
+ *      size_t n:         bytes needed, at most the writer's capacity
+ * Returns:
+ *      a pointer to the room
+ *
+ ********************************************/
+static unsigned char *writer_reserve(struct writer *w, size_t n)
+{
+        assert(n <= w->capacity);
+        if (w->used + n > w->capacity) {
+                writer_flush(w);
+        }
+        return w->buf + w->used;
+}
+
+/****************** writer_commit *******************
+ * 
+ * Queues the n bytes just serialized into the room from writer_reserve.
+ *
+ ********************************************/
+static void writer_commit(struct writer *w, size_t n)
+{
+        writer_add(w, w->buf + w->used, n);
+        w->used += n;
+}
+
+/****************** writer_finish *******************
+ * 
+ * Writes whatever is still queued and frees the writer's buffer.
+ *
+ ********************************************/
+static void writer_finish(struct writer *w)
+{
+        writer_flush(w);
+        FREE(w->slab);
+}
+
+/****************** strip_bytes *******************
+ * 
+ * Returns the longest run write_pixels serializes at once: one row, or
+ * for a UArray2b one row of blocks.
+ *
+ ********************************************/
+static size_t strip_bytes(const struct A2Methods_T *methods, A2 pixels,
+                          struct raster *r)
+{
+        size_t row_bytes = (size_t)methods->width(pixels) * r->pixel_bytes;
+        if (methods == uarray2_methods_blocked) {
+                return row_bytes * UArray2b_blocksize(pixels);
+        }
+        return row_bytes;
+}
+
+/****************** write_pixels *******************
+ * 
+ * Queues the cells of an array, as P6 raster rows, on a writer. The copy
+ * follows the array's layout:
+ *
+ *   - a plain UArray2 of packed 8-bit cells already holds each row in file
+ *     order, so the rows are written straight from the array, and rows
+ *     that are back to back (as in a view of a mapped file) go out as one
+ *     piece;
+ *   - other cells of a plain UArray2 are serialized a row at a time;
+ *   - a UArray2b is serialized a row of blocks at a time, walking each
+ *     block in memory order;
+ *   - any other array is gathered whole, as before.
+ *
+ * Parameters:
+ *      struct writer *w:                  the writer, with room for
+ *                                         strip_bytes
+ *      const struct A2Methods_T *methods: methods of pixels
+ *      A2 pixels:                         the array
+ *      struct raster *r:                  the format of the raster; its
+ *                                         bytes are set here
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void write_pixels(struct writer *w, const struct A2Methods_T *methods,
+                         A2 pixels, struct raster *r)
+{
+        int width = methods->width(pixels);
+        int height = methods->height(pixels);
+        size_t row_bytes = (size_t)width * r->pixel_bytes;
+
+        if (methods == uarray2_methods_plain) {
+                bool packed = r->cell_size == (int)sizeof(Pixel_rgb8);
+                for (int row = 0; row < height; row++) {
+                        void *cells = methods->at(pixels, 0, row);
+                        if (packed) {
+                                writer_add(w, cells, row_bytes);
+                                continue;
+                        }
+                        r->bytes = writer_reserve(w, row_bytes);
+                        r->row0 = row;
+                        gather_span(0, row, width, pixels, cells, r);
+                        writer_commit(w, row_bytes);
+                }
+        } else if (methods == uarray2_methods_blocked) {
+                int bs = UArray2b_blocksize(pixels);
+                for (int r0 = 0; r0 < height; r0 += bs) {
+                        int rows = height - r0 < bs ? height - r0 : bs;
+                        r->bytes = writer_reserve(w, rows * row_bytes);
+                        r->row0 = r0;
+                        for (int c0 = 0; c0 < width; c0 += bs) {
+                                int len = width - c0 < bs ? width - c0 : bs;
+                                char *block = UArray2b_block(pixels, c0 / bs,
+                                                             r0 / bs);
+                                for (int k = 0; k < rows; k++) {
+                                        gather_span(c0, r0 + k, len, pixels,
+                                                    block + (long)k * bs *
+                                                    r->cell_size, r);
+                                }
+                        }
+                        writer_commit(w, rows * row_bytes);
+                }
+        } else {
+                size_t raster_bytes = row_bytes * height;
+                r->bytes = ALLOC(raster_bytes);
+                r->row0 = 0;
+                if (methods->map_spans != NULL) {
+                        methods->map_spans(pixels, gather_span, r);
+                } else {
+                        methods->map_default(pixels, gather_cell, r);
+                }
+                writer_add(w, r->bytes, raster_bytes);
+                writer_flush(w);
+                FREE(r->bytes);
+        }
+}
+
+/****************** scan_header *******************
+ * 
+ * Reads the header of a P6 or P3 image. For P6 it also consumes the single
+ * whitespace character after maxval, leaving fp at the raster.
+ *
+ * Parameters:
+ *      FILE *fp:               the file to read from
+ *      struct Ppmio_header *h: filled in with the header's contents
+ * Returns:
+ *      true, or false if fp does not hold a well-formed header
+ *
+ ********************************************/
+static bool scan_header(FILE *fp, struct Ppmio_header *h)
+{
+        int c1 = getc(fp);
+        int c2 = getc(fp);
+        if (c1 != 'P' || (c2 != '6' && c2 != '3')) {
+                return false;
+        }
+        h->magic = c2;
+        if (!scan_number(fp, &h->width) || !scan_number(fp, &h->height) ||
+            !scan_number(fp, &h->maxval)) {
+                return false;
+        }
+        if (h->width == 0 || h->height == 0 || h->maxval == 0) {
+                return false;
+        }
+        if (h->magic == '6') {
+                /* exactly one whitespace character ends the header */
+                getc(fp);
+        }
+        return true;
+}
+
+/****************** Ppmio_read_header *******************
+ * 
+ * Reads the header of a P6 or P3 image, as scan_header does. Exported for
+ * the out-of-core engine, which reads the raster in strips with
+ * Ppmio_read_rows.
+ *
+ * Parameters:
+ *      FILE *fp:               the file to read from
+ *      struct Ppmio_header *h: filled in with the header's contents
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      fp holds a well-formed header (raises Pnm_Badformat if not)
+ *
+ ********************************************/
+void Ppmio_read_header(FILE *fp, struct Ppmio_header *h)
+{
+        assert(fp != NULL && h != NULL);
+        if (!scan_header(fp, h)) {
+                RAISE(Pnm_Badformat);
+        }
+}
+
+/****************** init_raster *******************
+ * 
+ * Sets up the format of the raster and array cells of an image, leaving
+ * the raster's bytes to the caller.
+ *
+ * Parameters:
+ *      struct raster *r:             the raster to set up
+ *      const struct Ppmio_header *h: the image's header
+ * Returns:
+ *      the number of bytes in the raster
+ *
+ ********************************************/
+static size_t init_raster(struct raster *r, const struct Ppmio_header *h)
+{
+        r->bytes = NULL;
+        r->row0 = 0;
+        r->width = h->width;
+        r->maxval = h->maxval;
+        r->sample_bytes = h->maxval > 255 ? 2 : 1;
+        r->pixel_bytes = 3 * r->sample_bytes;
+        r->cell_size = Pixel_size(h->maxval);
+        return (size_t)h->width * h->height * r->pixel_bytes;
+}
+
+/****************** Ppmio_set_threads *******************
+ * 
+ * Sets the number of threads that later reads decode an image with. With
+ * more than one, a P6 raster, or the text of a P3 image that is mapped
+ * into memory, is cut into bands that the shared work pool (workpool.c)
+ * decodes at once, straight into a plain or blocked array.
+ *
+ * Parameters:
+ *      int nthreads: the number of threads, the caller's included
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      nthreads is positive (throws a CRE if not)
+ *
+ ********************************************/
+void Ppmio_set_threads(int nthreads)
+{
+        assert(nthreads > 0);
+        decode_threads = nthreads;
+}
+
+/****************** scatter_rows *******************
+ * 
+ * Moves rows row0 .. row0 + nrows - 1 of the raster into a plain or
+ * blocked array, addressing the array's memory directly: a row of a
+ * UArray2 at a time, or for a UArray2b a row of each block in turn, in
+ * memory order.
+ *
+ * Parameters:
+ *      A2Methods_T methods: uarray2_methods_plain or _blocked
+ *      A2 pixels:           the array to fill
+ *      struct raster *r:    the raster, holding at least those rows
+ *      int row0, nrows:     the rows to move
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void scatter_rows(A2Methods_T methods, A2 pixels, struct raster *r,
+                         int row0, int nrows)
+{
+        int width = methods->width(pixels);
+        if (methods != uarray2_methods_blocked) {
+                for (int row = row0; row < row0 + nrows; row++) {
+                        scatter_span(0, row, width, pixels,
+                                     methods->at(pixels, 0, row), r);
+                }
+                return;
+        }
+        int bs = UArray2b_blocksize(pixels);
+        for (int row = row0; row < row0 + nrows; ) {
+                int in_block = row % bs;
+                int rows = bs - in_block;
+                if (rows > row0 + nrows - row) {
+                        rows = row0 + nrows - row;
+                }
+                for (int c0 = 0; c0 < width; c0 += bs) {
+                        int len = width - c0 < bs ? width - c0 : bs;
+                        char *block = UArray2b_block(pixels, c0 / bs,
+                                                     row / bs);
+                        for (int k = 0; k < rows; k++) {
+                                scatter_span(c0, row + k, len, pixels,
+                                             block + (long)(in_block + k) *
+                                             bs * r->cell_size, r);
+                        }
+                }
+                row += rows;
+        }
+}
+
+/********** band_job ********
+ * 
+ * A P6 raster being decoded in bands of rows, one task per band. The
+ * raster is either in memory or read by each task with pread.
+ *
+ *******************/
+struct band_job {
+        A2Methods_T methods;
+        A2 pixels;
+        struct raster format;        /* the raster's format; no bytes */
+        const unsigned char *raster; /* the raster in memory, or NULL */
+        int fd;                      /* else the file to pread it from */
+        off_t offset;                /* at this offset */
+        int band_rows, height;
+        char *failed;                /* per band: its pread came up short */
+};
+
+/****************** decode_band *******************
+ * 
+ * Task of a band_job: decodes band i into the array.
+ *
+ ********************************************/
+static void decode_band(int i, void *cl)
+{
+        struct band_job *job = cl;
+        int row0 = i * job->band_rows;
+        int nrows = job->height - row0;
+        if (nrows > job->band_rows) {
+                nrows = job->band_rows;
+        }
+        struct raster r = job->format;
+        r.row0 = row0;
+        size_t row_bytes = (size_t)r.width * r.pixel_bytes;
+        if (job->raster != NULL) {
+                r.bytes = (unsigned char *)job->raster + row0 * row_bytes;
+                scatter_rows(job->methods, job->pixels, &r, row0, nrows);
+                return;
+        }
+
+        size_t bytes = nrows * row_bytes;
+        off_t at = job->offset + (off_t)row0 * row_bytes;
+        r.bytes = ALLOC(bytes);
+        size_t done = 0;
+        while (done < bytes) {
+                ssize_t n = pread(job->fd, r.bytes + done, bytes - done,
+                                  at + done);
+                if (n <= 0) {
+                        break;
+                }
+                done += n;
+        }
+        if (done == bytes) {
+                scatter_rows(job->methods, job->pixels, &r, row0, nrows);
+        } else {
+                job->failed[i] = 1;
+        }
+        FREE(r.bytes);
+}
+
+/****************** decodes_in_parallel *******************
+ * 
+ * Tells whether an array is filled by the parallel decoder: there must be
+ * more than one decoding thread, and the array must be plain or blocked,
+ * whose memory the decoder addresses directly.
+ *
+ ********************************************/
+static bool decodes_in_parallel(A2Methods_T methods)
+{
+        return decode_threads > 1 && (methods == uarray2_methods_plain ||
+                                      methods == uarray2_methods_blocked);
+}
+
+/****************** decode_bands *******************
+ * 
+ * Decodes a P6 raster into a plain or blocked array in parallel, in bands
+ * of rows. A band of a blocked array is a whole number of block rows, so no
+ * two threads write the same block.
+ *
+ * Parameters:
+ *      A2Methods_T methods:         methods of pixels
+ *      A2 pixels:                   the array to fill
+ *      struct raster *r:            the raster's format
+ *      const unsigned char *raster: the raster in memory, or NULL to read
+ *                                   it with pread
+ *      int fd, off_t offset:        the file and offset to read it at
+ * Returns:
+ *      true, or false if the file ends before the raster does
+ *
+ ********************************************/
+static bool decode_bands(A2Methods_T methods, A2 pixels, struct raster *r,
+                         const unsigned char *raster, int fd, off_t offset)
+{
+        struct band_job job;
+        job.methods = methods;
+        job.pixels = pixels;
+        job.format = *r;
+        job.raster = raster;
+        job.fd = fd;
+        job.offset = offset;
+        job.height = methods->height(pixels);
+
+        int bands = decode_threads * BANDS_PER_THREAD;
+        int unit = methods == uarray2_methods_blocked ?
+                   UArray2b_blocksize(pixels) : 1;
+        job.band_rows = (job.height + bands - 1) / bands;
+        job.band_rows = (job.band_rows + unit - 1) / unit * unit;
+        bands = (job.height + job.band_rows - 1) / job.band_rows;
+
+        job.failed = CALLOC(bands, 1);
+        Workpool_run(Workpool_shared(decode_threads), bands, decode_band,
+                     &job);
+        bool ok = memchr(job.failed, 1, bands) == NULL;
+        FREE(job.failed);
+        return ok;
+}
+
+/********** text_job ********
+ * 
+ * The samples of a P3 image being parsed in parallel. The text is cut
+ * into chunks that each start at the beginning of a line, so no number or
+ * comment straddles two chunks. A first pass counts the samples of each
+ * chunk; once the counts are summed into starting indices, a second pass
+ * parses each chunk into its place in the raster.
+ *
+ *******************/
+struct text_job {
+        const char *text;
+        size_t *starts;    /* nchunks + 1 chunk boundaries in text */
+        long *first;       /* per chunk: its sample count, then its first
+                              sample's index */
+        char *failed;      /* per chunk: it holds something not a sample */
+        struct raster *r;  /* raster being filled, of nsamples samples */
+        long nsamples;
+        bool counting;     /* first pass or second */
+};
+
+/****************** parse_chunk *******************
+ * 
+ * Task of a text_job: counts the samples of chunk i, or parses them into
+ * the raster, skipping whitespace and comments as skip_space does. A
+ * sample above the raster's maxval fails the chunk, as it fails the
+ * serial reader.
+ *
+ ********************************************/
+static void parse_chunk(int i, void *cl)
+{
+        struct text_job *job = cl;
+        const char *p = job->text + job->starts[i];
+        const char *end = job->text + job->starts[i + 1];
+        long index = job->counting ? 0 : job->first[i];
+        int sample_bytes = job->r->sample_bytes;
+        while (p < end) {
+                char c = *p;
+                if (c == '#') {
+                        while (p < end && *p != '\n') {
+                                p++;
+                        }
+                } else if (c >= '0' && c <= '9') {
+                        unsigned v = 0;
+                        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+                                v = v * 10 + (*p - '0');
+                                if (v > 65535) {
+                                        job->failed[i] = 1;
+                                        return;
+                                }
+                        }
+                        if (!job->counting && index < job->nsamples) {
+                                if (v > job->r->maxval) {
+                                        job->failed[i] = 1;
+                                        return;
+                                }
+                                unsigned char *out = job->r->bytes +
+                                                     index * sample_bytes;
+                                if (sample_bytes == 2) {
+                                        *out++ = v >> 8;
+                                }
+                                *out = v & 0xff;
+                        }
+                        index++;
+                } else if (c == ' ' || c == '\t' || c == '\n' ||
+                           c == '\r' || c == '\v' || c == '\f') {
+                        p++;
+                } else {
+                        job->failed[i] = 1;
+                        return;
+                }
+        }
+        if (job->counting) {
+                job->first[i] = index;
+        }
+}
+
+/****************** parse_text *******************
+ * 
+ * Builds the P6 raster of a P3 image from its text in parallel.
+ *
+ * Parameters:
+ *      const char *text:  the samples, in ASCII
+ *      size_t length:     bytes of text
+ *      struct raster *r:  the raster to fill
+ *      long nsamples:     number of samples to read
+ * Returns:
+ *      true, or false if the text holds fewer samples than that, a
+ *      sample above the raster's maxval, or anything that is not a
+ *      sample, whitespace or comment
+ *
+ ********************************************/
+static bool parse_text(const char *text, size_t length, struct raster *r,
+                       long nsamples)
+{
+        int nchunks = decode_threads * BANDS_PER_THREAD;
+        struct text_job job;
+        job.text = text;
+        job.r = r;
+        job.nsamples = nsamples;
+        job.starts = CALLOC(nchunks + 1, sizeof *job.starts);
+        job.first = CALLOC(nchunks, sizeof *job.first);
+        job.failed = CALLOC(nchunks, 1);
+
+        /* each chunk starts just past a newline */
+        for (int k = 1; k < nchunks; k++) {
+                size_t at = length / nchunks * k;
+                if (at < job.starts[k - 1]) {
+                        at = job.starts[k - 1];
+                }
+                const char *nl = memchr(text + at, '\n', length - at);
+                job.starts[k] = nl == NULL ? length : (size_t)(nl + 1 - text);
+        }
+        job.starts[nchunks] = length;
+
+        Workpool_T pool = Workpool_shared(decode_threads);
+        job.counting = true;
+        Workpool_run(pool, nchunks, parse_chunk, &job);
+        long total = 0;
+        for (int k = 0; k < nchunks; k++) {
+                long count = job.first[k];
+                job.first[k] = total;
+                total += count;
+        }
+        bool ok = total >= nsamples &&
+                  memchr(job.failed, 1, nchunks) == NULL;
+        if (ok) {
+                job.counting = false;
+                Workpool_run(pool, nchunks, parse_chunk, &job);
+                ok = memchr(job.failed, 1, nchunks) == NULL;
+        }
+        FREE(job.starts);
+        FREE(job.first);
+        FREE(job.failed);
+        return ok;
+}
+
+/****************** scatter *******************
+ * 
+ * Moves a raster into an array of its width and height: in parallel
+ * bands when there are decoding threads and the array's memory can be
+ * addressed directly, else a span at a time when the methods provide
+ * map_spans.
+ *
+ * Parameters:
+ *      A2Methods_T methods: methods of the array
+ *      A2 pixels:           the array to fill
+ *      struct raster *r:    the raster, with as many rows as the array
+ * Returns:
+ *      Nothing
+ *
+ ********************************************/
+static void scatter(A2Methods_T methods, A2 pixels, struct raster *r)
+{
+        if (decodes_in_parallel(methods)) {
+                decode_bands(methods, pixels, r, r->bytes, -1, 0);
+        } else if (methods->map_spans != NULL) {
+                methods->map_spans(pixels, scatter_span, r);
+        } else {
+                methods->map_default(pixels, scatter_cell, r);
+        }
+}
+
+/****************** fill_array *******************
+ * 
+ * Makes the pixel array of an image and scatters the raster into it.
+ *
+ * Parameters:
+ *      A2Methods_T methods:          methods used to make the array
+ *      const struct Ppmio_header *h: the image's header
+ *      struct raster *r:             the image's raster
+ * Returns:
+ *      the filled-in array
+ *
+ ********************************************/
+static A2 fill_array(A2Methods_T methods, const struct Ppmio_header *h,
+                     struct raster *r)
+{
+        A2 pixels = methods->new(h->width, h->height, r->cell_size);
+        scatter(methods, pixels, r);
+        return pixels;
+}
+
+/****************** new_pixmap *******************
+ * 
+ * Wraps an image's header and pixel array in a new Pnm_ppm.
+ *
+ ********************************************/
+static Pnm_ppm new_pixmap(const struct Ppmio_header *h, A2Methods_T methods,
+                          A2 pixels)
+{
+        Pnm_ppm pixmap;
+        NEW(pixmap);
+        pixmap->width = h->width;
+        pixmap->height = h->height;
+        pixmap->denominator = h->maxval;
+        pixmap->methods = methods;
+        pixmap->pixels = pixels;
+        return pixmap;
+}
+
+/****************** Ppmio_read *******************
+ * 
+ * Reads a P6 or P3 image into a new array made by methods. An image with
+ * maxval <= 255 gets 3-byte Pixel_rgb8 cells, any other 6-byte
+ * Pixel_rgb16 cells.
+ *
+ * Parameters:
+ *      FILE *fp:            the file to read from
+ *      A2Methods_T methods: methods used to make the pixel array
+ * Returns:
+ *      the image read
+ * Expects:
+ *      fp and methods are not NULL (throws a CRE if NULL).
+ *      fp holds a well-formed P6 or P3 image (raises Pnm_Badformat if not).
+ *
+ ********************************************/
+Pnm_ppm Ppmio_read(FILE *fp, A2Methods_T methods)
+{
+        assert(fp != NULL && methods != NULL);
+        struct Ppmio_header h;
+        Ppmio_read_header(fp, &h);
+
+        struct raster r;
+        size_t raster_bytes = init_raster(&r, &h);
+
+        /* a P6 raster in a regular file is read by the decoding threads,
+           each with pread, and never held whole */
+        struct stat st;
+        if (h.magic == '6' && decodes_in_parallel(methods) &&
+            fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode)) {
+                off_t offset = ftello(fp);
+                A2 pixels = methods->new(h.width, h.height, r.cell_size);
+                if (!decode_bands(methods, pixels, &r, NULL, fileno(fp),
+                                  offset)) {
+                        methods->free(&pixels);
+                        RAISE(Pnm_Badformat);
+                }
+                fseeko(fp, offset + raster_bytes, SEEK_SET);
+                return new_pixmap(&h, methods, pixels);
+        }
+
+        r.bytes = ALLOC(raster_bytes);
+        if (h.magic == '6') {
+                if (fread(r.bytes, 1, raster_bytes, fp) != raster_bytes) {
+                        FREE(r.bytes);
+                        RAISE(Pnm_Badformat);
+                }
+        } else {
+                read_plain_raster(fp, &r, (long)h.width * h.height * 3);
+        }
+
+        A2 pixels = fill_array(methods, &h, &r);
+        FREE(r.bytes);
+        return new_pixmap(&h, methods, pixels);
+}
+
+/****************** scan_rows *******************
+ * 
+ * Reads the next rows of the raster of an image whose header has been
+ * read, as many as pixels has, into pixels.
+ *
+ * Parameters:
+ *      FILE *fp:                     positioned at the rows to read
+ *      const struct Ppmio_header *h: the image's header
+ *      A2Methods_T methods:          methods of pixels
+ *      A2 pixels:                    array to fill, as wide as the image,
+ *                                    with cells of size Pixel_size(maxval)
+ * Returns:
+ *      true, or false if fp does not hold enough well-formed rows
+ * Expects:
+ *      pixels has the image's width and cell size (throws a CRE if not)
+ *
+ ********************************************/
+static bool scan_rows(FILE *fp, const struct Ppmio_header *h,
+                      A2Methods_T methods, A2 pixels)
+{
+        struct raster r;
+        init_raster(&r, h);
+        int nrows = methods->height(pixels);
+        assert(methods->width(pixels) == (int)h->width);
+        assert(methods->size(pixels) == r.cell_size);
+
+        size_t raster_bytes = (size_t)h->width * nrows * r.pixel_bytes;
+        r.bytes = ALLOC(raster_bytes);
+        bool ok = h->magic == '6' ?
+                  fread(r.bytes, 1, raster_bytes, fp) == raster_bytes :
+                  scan_plain_raster(fp, &r, (long)h->width * nrows * 3);
+        if (ok) {
+                scatter(methods, pixels, &r);
+        }
+        FREE(r.bytes);
+        return ok;
+}
+
+/****************** Ppmio_read_rows *******************
+ * 
+ * Reads the next rows of the raster of an image whose header has been
+ * read, as many as pixels has, into pixels. Lets an image be read one
+ * horizontal strip at a time.
+ *
+ * Parameters:
+ *      FILE *fp:                     positioned at the rows to read
+ *      const struct Ppmio_header *h: the image's header
+ *      A2Methods_T methods:          methods of pixels
+ *      A2 pixels:                    array to fill, as wide as the image,
+ *                                    with cells of size Pixel_size(maxval)
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers are NULL and pixels has the image's width and
+ *      cell size (throws a CRE if not).
+ *      fp holds enough rows (raises Pnm_Badformat if not).
+ *
+ ********************************************/
+void Ppmio_read_rows(FILE *fp, const struct Ppmio_header *h,
+                     A2Methods_T methods, A2Methods_UArray2 pixels)
+{
+        assert(fp != NULL && h != NULL && methods != NULL && pixels != NULL);
+        if (!scan_rows(fp, h, methods, pixels)) {
+                RAISE(Pnm_Badformat);
+        }
+}
+
+/****************** Ppmio_scan_next *******************
+ * 
+ * Reads the next image of a stream of images written back to back, such
+ * as the frames of a capture, into the image read before it if it has
+ * the same size and cell format. An 8-bit P6 frame read into a plain array
+ * goes straight from the stream into the array's rows, which have the
+ * raster's layout; any other frame is decoded as Ppmio_read_rows does.
+ * Nothing is raised, so a thread other than the one in a TRY, such as a
+ * server's connection worker, can read with it.
+ *
+ * Parameters:
+ *      FILE *fp:            the stream to read from
+ *      A2Methods_T methods: methods used to make the pixel array
+ *      Pnm_ppm *image:      NULL, or the last image read from the stream;
+ *                           set to the image read
+ * Returns:
+ *      1 if an image was read, 0 if the stream had ended, with nothing but
+ *      whitespace after the last image, or -1 if what follows is not a
+ *      well-formed P6 or P3 image, in which case *image, if not NULL, holds
+ *      whatever part of it was read
+ * Expects:
+ *      None of the pointers are NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+int Ppmio_scan_next(FILE *fp, A2Methods_T methods, Pnm_ppm *image)
+{
+        assert(fp != NULL && methods != NULL && image != NULL);
+        int c;
+        do {
+                c = getc(fp);
+        } while (c != EOF && isspace(c));
+        if (c == EOF) {
+                return 0;
+        }
+        ungetc(c, fp);
+
+        struct Ppmio_header h;
+        if (!scan_header(fp, &h)) {
+                return -1;
+        }
+        int cell_size = Pixel_size(h.maxval);
+
+        /* keep the last image's array if the frame fits it */
+        Pnm_ppm pixmap = *image;
+        if (pixmap != NULL &&
+            (pixmap->width != h.width || pixmap->height != h.height ||
+             pixmap->methods != methods ||
+             methods->size(pixmap->pixels) != cell_size)) {
+                Pnm_ppmfree(image);
+                pixmap = NULL;
+        }
+        if (pixmap == NULL) {
+                pixmap = new_pixmap(&h, methods,
+                                    methods->new(h.width, h.height,
+                                                 cell_size));
+        }
+        pixmap->denominator = h.maxval;
+        *image = pixmap;
+
+        if (h.magic == '6' && methods == uarray2_methods_plain &&
+            cell_size == (int)sizeof(Pixel_rgb8)) {
+                size_t row_bytes = (size_t)h.width * cell_size;
+                for (unsigned row = 0; row < h.height; row++) {
+                        void *cells = methods->at(pixmap->pixels, 0, row);
+                        if (fread(cells, 1, row_bytes, fp) != row_bytes) {
+                                return -1;
+                        }
+                }
+                return 1;
+        }
+        return scan_rows(fp, &h, methods, pixmap->pixels) ? 1 : -1;
+}
+
+/****************** Ppmio_read_next *******************
+ * 
+ * Reads the next image of a stream of images written back to back, as
+ * Ppmio_scan_next does.
+ *
+ * Parameters:
+ *      FILE *fp:            the stream to read from
+ *      A2Methods_T methods: methods used to make the pixel array
+ *      Pnm_ppm *image:      NULL, or the last image read from the stream;
+ *                           set to the image read
+ * Returns:
+ *      true if an image was read, false if the stream had ended, with
+ *      nothing but whitespace after the last image
+ * Expects:
+ *      None of the pointers are NULL (throws a CRE if NULL).
+ *      What follows in fp is a well-formed P6 or P3 image (raises
+ *      Pnm_Badformat if not).
+ *
+ ********************************************/
+bool Ppmio_read_next(FILE *fp, A2Methods_T methods, Pnm_ppm *image)
+{
+        int read = Ppmio_scan_next(fp, methods, image);
+        if (read < 0) {
+                RAISE(Pnm_Badformat);
+        }
+        return read > 0;
+}
+
+/********** mapping ********
+ * 
+ * A file mapped into memory, kept until the array viewing it is freed.
+ *
+ *******************/
+struct mapping {
+        void *base;
+        size_t length;
+};
+
+/****************** unmap *******************
+ * 
+ * Release function of a view of a mapped raster: unmaps the file.
+ *
+ ********************************************/
+static void unmap(void *cl)
+{
+        struct mapping *m = cl;
+        munmap(m->base, m->length);
+        FREE(m);
+}
+
+/****************** unmap_rejected *******************
+ * 
+ * Releases what Ppmio_scan_map holds for a malformed image, so that the
+ * mapping, the stream reading it and any raster being decoded are not
+ * leaked.
+ *
+ * Parameters:
+ *      FILE *fp:             the stream reading the mapping
+ *      void *base:           the mapping
+ *      size_t length:        its length
+ *      unsigned char *bytes: a raster being decoded, or NULL
+ * Returns:
+ *      -1, Ppmio_scan_map's result for a malformed image
+ *
+ ********************************************/
+static int unmap_rejected(FILE *fp, void *base, size_t length,
+                          unsigned char *bytes)
+{
+        if (bytes != NULL) {
+                FREE(bytes);
+        }
+        fclose(fp);
+        munmap(base, length);
+        return -1;
+}
+
+/****************** Ppmio_scan_map *******************
+ * 
+ * Reads the image in the named file by mapping the file into memory. The
+ * raster is read in place instead of being copied through stdio. When the
+ * methods are uarray2_methods_plain and the image is 8-bit P6, the raster
+ * already has the layout of a row-major array of Pixel_rgb8. So the image
+ * is not copied at all: its pixels are a read-only UArray2 view of the
+ * mapping, and the first transformation reads straight from the page
+ * cache. The file stays mapped until that array is freed. Nothing is
+ * raised, so a pool worker, such as one of -batch's, can read with it.
+ *
+ * Parameters:
+ *      const char *path:    name of the file
+ *      A2Methods_T methods: methods used to make the pixel array
+ *      Pnm_ppm *image:      set to the image read, if one is
+ * Returns:
+ *      1 if an image was read, 0 if the file cannot be opened or mapped
+ *      (a pipe, say), in which case the caller should read it through
+ *      stdio, or -1 if the file does not hold a well-formed P6 or P3
+ *      image
+ * Expects:
+ *      None of the pointers are NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+int Ppmio_scan_map(const char *path, A2Methods_T methods, Pnm_ppm *image)
+{
+        assert(path != NULL && methods != NULL && image != NULL);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+                return 0;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+                close(fd);
+                return 0;
+        }
+        size_t length = st.st_size;
+        unsigned char *base = mmap(NULL, length, PROT_READ, MAP_PRIVATE,
+                                   fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+                return 0;
+        }
+
+        /* the header is parsed by the stdio code, reading the mapping */
+        FILE *fp = fmemopen(base, length, "r");
+        assert(fp != NULL);
+        struct Ppmio_header h;
+        if (!scan_header(fp, &h)) {
+                return unmap_rejected(fp, base, length, NULL);
+        }
+
+        struct raster r;
+        size_t raster_bytes = init_raster(&r, &h);
+        A2 pixels;
+        if (h.magic == '6') {
+                size_t offset = ftell(fp);
+                if (offset + raster_bytes > length) {
+                        return unmap_rejected(fp, base, length, NULL);
+                }
+                r.bytes = base + offset;
+                if (methods == uarray2_methods_plain &&
+                    r.cell_size == (int)sizeof(Pixel_rgb8)) {
+                        struct mapping *m;
+                        NEW(m);
+                        m->base = base;
+                        m->length = length;
+                        pixels = UArray2_view(h.width, h.height, r.cell_size,
+                                              (long)h.width * r.pixel_bytes,
+                                              r.bytes, unmap, m);
+                        fclose(fp);
+                        *image = new_pixmap(&h, methods, pixels);
+                        return 1;
+                }
+                pixels = fill_array(methods, &h, &r);
+        } else {
+                r.bytes = ALLOC(raster_bytes);
+                long nsamples = (long)h.width * h.height * 3;
+                size_t offset = ftell(fp);
+                bool ok = decode_threads > 1 ?
+                          parse_text((char *)base + offset, length - offset,
+                                     &r, nsamples) :
+                          scan_plain_raster(fp, &r, nsamples);
+                if (!ok) {
+                        return unmap_rejected(fp, base, length, r.bytes);
+                }
+                pixels = fill_array(methods, &h, &r);
+                FREE(r.bytes);
+        }
+        fclose(fp);
+        munmap(base, length);
+        *image = new_pixmap(&h, methods, pixels);
+        return 1;
+}
+
+/****************** Ppmio_map *******************
+ * 
+ * Reads the image in the named file by mapping the file into memory, as
+ * Ppmio_scan_map does.
+ *
+ * Parameters:
+ *      const char *path:    name of the file
+ *      A2Methods_T methods: methods used to make the pixel array
+ * Returns:
+ *      the image read, or NULL if the file cannot be opened or mapped (a
+ *      pipe, say), in which case the caller should use Ppmio_read
+ * Expects:
+ *      path and methods are not NULL (throws a CRE if NULL).
+ *      The file holds a well-formed P6 or P3 image (raises Pnm_Badformat
+ *      if not).
+ *
+ ********************************************/
+Pnm_ppm Ppmio_map(const char *path, A2Methods_T methods)
+{
+        Pnm_ppm image = NULL;
+        if (Ppmio_scan_map(path, methods, &image) < 0) {
+                RAISE(Pnm_Badformat);
+        }
+        return image;
+}
+
+/****************** Ppmio_create *******************
+ * 
+ * Creates the named file as an 8-bit P6 image of the given size and maps
+ * it into memory for writing. The header is written at once and the file
+ * is given its full length up front, so the raster is backed by real disk
+ * blocks; the returned array is a UArray2 view of the mapped raster. A
+ * transformation that copies into it (see output_driver) writes the
+ * output file directly, with no separate write pass. The file is complete
+ * once the array is freed, which unmaps it.
+ *
+ * Parameters:
+ *      const char *path: name of the file to create (or truncate)
+ *      int width:        width of the image
+ *      int height:       height of the image
+ *      unsigned maxval:  maxval to write in the header
+ * Returns:
+ *      a plain UArray2 of Pixel_rgb8 to be used with
+ *      uarray2_methods_plain, or NULL if maxval is above 255 (the
+ *      file's samples would be big-endian, unlike a Pixel_rgb16) or the
+ *      file cannot be created, sized or mapped, in which case the caller
+ *      should write with Ppmio_write
+ * Expects:
+ *      path is not NULL, width and height are positive (throws a CRE if
+ *      not)
+ *
+ ********************************************/
+A2Methods_UArray2 Ppmio_create(const char *path, int width, int height,
+                               unsigned maxval)
+{
+        assert(path != NULL && width > 0 && height > 0);
+        if (maxval == 0 || maxval > 255) {
+                return NULL;
+        }
+        int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+                return NULL;
+        }
+
+        char header[64];
+        int header_bytes = snprintf(header, sizeof header, "P6\n%d %d\n%u\n",
+                                    width, height, maxval);
+        long stride = (long)width * sizeof(Pixel_rgb8);
+        size_t length = header_bytes + (size_t)stride * height;
+        unsigned char *base = MAP_FAILED;
+        if (write(fd, header, header_bytes) == header_bytes &&
+            ftruncate(fd, length) == 0 &&
+            posix_fallocate(fd, 0, length) == 0) {
+                base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                            fd, 0);
+        }
+        close(fd);
+        if (base == MAP_FAILED) {
+                return NULL;
+        }
+
+        struct mapping *m;
+        NEW(m);
+        m->base = base;
+        m->length = length;
+        return UArray2_view(width, height, sizeof(Pixel_rgb8), stride,
+                            base + header_bytes, unmap, m);
+}
+
+/****************** mirror_rows *******************
+ * 
+ * Reverses the order of the pixels within each of a run of raster rows.
+ *
+ * Parameters:
+ *      struct raster *r: the raster's format, with the rows in bytes
+ *      long nrows:       the number of rows
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      r is not NULL and r->bytes holds nrows rows
+ *
+ ********************************************/
+static void mirror_rows(struct raster *r, long nrows)
+{
+        int pb = r->pixel_bytes;
+        unsigned char tmp[6];
+        for (long row = 0; row < nrows; row++) {
+                unsigned char *left = r->bytes + row * r->width * pb;
+                unsigned char *right = left + (long)(r->width - 1) * pb;
+                for (; left < right; left += pb, right -= pb) {
+                        memcpy(tmp, left, pb);
+                        memcpy(left, right, pb);
+                        memcpy(right, tmp, pb);
+                }
+        }
+}
+
+/****************** Ppmio_stream *******************
+ * 
+ * Applies a transformation that keeps the image's dimensions (the
+ * identity, the two flips and the 180 degree rotation) while copying an
+ * image from in to out as P6, a chunk of rows at a time. Each such
+ * transformation moves every row to one row of the output, possibly
+ * mirrored: the flips need only reverse the pixels of a row or the order
+ * of the rows, and the rotation does both. So no image is ever built.
+ * Rows are read forwards for the identity and the horizontal flip, and
+ * backwards, from the end of the raster, for the vertical flip and the
+ * rotation, which needs a P6 image in a regular file (one that can be
+ * read with pread at any offset). Memory then stays at STREAM_BYTES, or a
+ * single row if that is larger. A P3 image or a pipe that has to be read
+ * backwards is loaded whole, in raster form, first.
+ *
+ * Parameters:
+ *      FILE *in:  the file to read a P6 or P3 image from
+ *      FILE *out: the file to write the transformed image to
+ *      D4_T t:    the transformation
+ *      int *width, *height: set to the image's dimensions
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers are NULL and t keeps the dimensions (throws a
+ *      CRE if not).
+ *      in holds a well-formed image (raises Pnm_Badformat if not).
+ *
+ ********************************************/
+void Ppmio_stream(FILE *in, FILE *out, D4_T t, int *width, int *height)
+{
+        assert(in != NULL && out != NULL);
+        assert(width != NULL && height != NULL);
+        assert(!D4_swaps_dimensions(t));
+        struct Ppmio_header h;
+        Ppmio_read_header(in, &h);
+        *width = h.width;
+        *height = h.height;
+
+        struct raster r;
+        init_raster(&r, &h);
+        D4_map m = D4_affine(t, h.width, h.height);
+        bool mirror = m.xx < 0;
+        bool reverse = m.yy < 0;
+
+        /* a backwards read of the rows needs the raster at a known offset */
+        struct stat st;
+        bool seekable = h.magic == '6' && fstat(fileno(in), &st) == 0 &&
+                        S_ISREG(st.st_mode);
+        off_t start = seekable ? ftello(in) : 0;
+
+        size_t row_bytes = (size_t)h.width * r.pixel_bytes;
+        long chunk_rows = STREAM_BYTES / row_bytes;
+        if (chunk_rows < 1) {
+                chunk_rows = 1;
+        }
+        if (chunk_rows > (long)h.height || (reverse && !seekable)) {
+                chunk_rows = h.height;
+        }
+        r.bytes = ALLOC(chunk_rows * row_bytes);
+
+        fprintf(out, "P6\n%u %u\n%u\n", h.width, h.height, h.maxval);
+        struct writer w;
+        writer_init(&w, out, 0);
+        for (long done = 0; done < (long)h.height; done += chunk_rows) {
+                long n = (long)h.height - done;
+                if (n > chunk_rows) {
+                        n = chunk_rows;
+                }
+                size_t bytes = n * row_bytes;
+
+                /* the chunk's rows, first to last in the source */
+                if (h.magic == '3') {
+                        read_plain_raster(in, &r, n * h.width * 3);
+                } else if (reverse && seekable) {
+                        off_t first = (long)h.height - done - n;
+                        if (pread(fileno(in), r.bytes, bytes,
+                                  start + first * (off_t)row_bytes)
+                            != (ssize_t)bytes) {
+                                FREE(r.bytes);
+                                RAISE(Pnm_Badformat);
+                        }
+                } else if (fread(r.bytes, 1, bytes, in) != bytes) {
+                        FREE(r.bytes);
+                        RAISE(Pnm_Badformat);
+                }
+
+                if (mirror) {
+                        mirror_rows(&r, n);
+                }
+                if (reverse) {
+                        for (long row = n - 1; row >= 0; row--) {
+                                writer_add(&w, r.bytes + row * row_bytes,
+                                           row_bytes);
+                        }
+                } else {
+                        writer_add(&w, r.bytes, bytes);
+                }
+                /* the chunk's memory is reused for the next chunk */
+                writer_flush(&w);
+        }
+        writer_finish(&w);
+        FREE(r.bytes);
+}
+
+/****************** init_writing *******************
+ * 
+ * Sets up the format of the raster an array is written as.
+ *
+ ********************************************/
+static void init_writing(struct raster *r, const struct A2Methods_T *methods,
+                         A2 pixels, unsigned maxval)
+{
+        r->bytes = NULL;
+        r->row0 = 0;
+        r->width = methods->width(pixels);
+        r->maxval = maxval;
+        r->sample_bytes = maxval > 255 ? 2 : 1;
+        r->pixel_bytes = 3 * r->sample_bytes;
+        r->cell_size = methods->size(pixels);
+        assert(r->cell_size != (int)sizeof(Pixel_rgb8) ||
+               r->sample_bytes == 1);
+        assert(r->cell_size != (int)sizeof(Pixel_rgb16) ||
+               r->sample_bytes == 2);
+}
+
+/****************** Ppmio_write *******************
+ * 
+ * Writes an image as P6, in cells of any format of pixel.h. The header and
+ * the raster are queued on a writer, so they go out in a few large writev
+ * calls that skip stdio.
+ *
+ * Parameters:
+ *      FILE *fp:       the file to write to
+ *      Pnm_ppm pixmap: the image
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      fp and pixmap are not NULL (throws a CRE if NULL).
+ *      8-bit cells hold an image with maxval <= 255 and 16-bit cells one
+ *      with maxval > 255 (throws a CRE if not).
+ *
+ ********************************************/
+void Ppmio_write(FILE *fp, Pnm_ppm pixmap)
+{
+        assert(fp != NULL && pixmap != NULL);
+        struct raster r;
+        init_writing(&r, pixmap->methods, pixmap->pixels,
+                     pixmap->denominator);
+        struct writer w;
+        writer_init(&w, fp, strip_bytes(pixmap->methods, pixmap->pixels, &r));
+
+        /* the header leads the first piece */
+        char *header = (char *)writer_reserve(&w, 64);
+        int header_bytes = snprintf(header, 64, "P6\n%u %u\n%u\n",
+                                    pixmap->width, pixmap->height,
+                                    pixmap->denominator);
+        writer_commit(&w, header_bytes);
+
+        write_pixels(&w, pixmap->methods, pixmap->pixels, &r);
+        writer_finish(&w);
+}
+
+/****************** Ppmio_write_rows *******************
+ * 
+ * Writes the cells of an array as rows of a P6 raster, with no header, so
+ * an image can be written one horizontal strip at a time.
+ *
+ * Parameters:
+ *      FILE *fp:            the file to write to
+ *      A2Methods_T methods: methods of pixels
+ *      A2 pixels:           the rows to write
+ *      unsigned maxval:     the image's maxval
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      None of the pointers are NULL (throws a CRE if NULL).
+ *      8-bit cells hold an image with maxval <= 255 and 16-bit cells one
+ *      with maxval > 255 (throws a CRE if not).
+ *
+ ********************************************/
+void Ppmio_write_rows(FILE *fp, const struct A2Methods_T *methods,
+                      A2Methods_UArray2 pixels, unsigned maxval)
+{
+        assert(fp != NULL && methods != NULL && pixels != NULL);
+        struct raster r;
+        init_writing(&r, methods, pixels, maxval);
+        struct writer w;
+        writer_init(&w, fp, strip_bytes(methods, pixels, &r));
+        write_pixels(&w, methods, pixels, &r);
+        writer_finish(&w);
+}
@@ -0,0 +1,98 @@
+/**************************************************************
+ *
+ *                     ppmio.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for reading and writing PPM images in the cell
+ *              formats of pixel.h. Pnm_ppmread always stores a pixel as a
+ *              12-byte struct Pnm_rgb. Ppmio_read stores an 8-bit image
+ *              in 3-byte cells and a 16-bit one in 6-byte cells instead,
+ *              so every later pass over the image moves a quarter or a
+ *              half of the memory.
+ *              
+ **************************************************************/
+
+#ifndef PPMIO_INCLUDED
+#define PPMIO_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+#include "pnm.h"
+#include "d4.h"
+
+/* the contents of a PPM header */
+struct Ppmio_header {
+        int magic;        /* '6' for P6, '3' for P3 */
+        unsigned width, height, maxval;
+};
+
+/* reads the header of a P6 or P3 image, leaving fp at its raster. Raises
+   Pnm_Badformat if fp does not hold one */
+extern void Ppmio_read_header(FILE *fp, struct Ppmio_header *h);
+
+/* reads the next methods->height(pixels) rows of the raster into pixels,
+   which is as wide as the image with cells of size Pixel_size(maxval).
+   Raises Pnm_Badformat if fp runs out of rows */
+extern void Ppmio_read_rows(FILE *fp, const struct Ppmio_header *h,
+                            A2Methods_T methods, A2Methods_UArray2 pixels);
+
+/* reads the next image of a stream of images written back to back into
+   *image, reusing the array of the image already there if it has the same
+   size and cells. Returns false if only whitespace is left. Raises
+   Pnm_Badformat if the next image is not well formed */
+extern bool Ppmio_read_next(FILE *fp, A2Methods_T methods, Pnm_ppm *image);
+
+/* as Ppmio_read_next, but raises nothing: returns 1 if an image was read,
+   0 if only whitespace is left, and -1 if the next image is not well
+   formed, so that threads that must not use the exception stack can read
+   streams */
+extern int Ppmio_scan_next(FILE *fp, A2Methods_T methods, Pnm_ppm *image);
+
+/* sets the number of threads later reads decode with (1 at first): a P6
+   raster, or P3 text mapped by Ppmio_map, is then decoded in parallel
+   bands straight into a plain or blocked array */
+extern void Ppmio_set_threads(int nthreads);
+
+/* reads a P6 or P3 image into an array made by methods, whose cells have
+   size Pixel_size(maxval). Raises Pnm_Badformat if fp does not hold one */
+extern Pnm_ppm Ppmio_read(FILE *fp, A2Methods_T methods);
+
+/* reads the named file by mapping it into memory. An 8-bit P6 image read
+   with uarray2_methods_plain is not copied: its pixels are a read-only
+   view of the mapped raster. Returns NULL if the file cannot be mapped */
+extern Pnm_ppm Ppmio_map(const char *path, A2Methods_T methods);
+
+/* as Ppmio_map, but raises nothing: returns 1 and sets *image if an image
+   was read, 0 if the file cannot be mapped, and -1 if it does not hold a
+   well-formed image */
+extern int Ppmio_scan_map(const char *path, A2Methods_T methods,
+                          Pnm_ppm *image);
+
+/* creates the named file as an 8-bit P6 image of the given size and
+   returns a UArray2 view of its mapped raster, for uarray2_methods_plain.
+   The file is complete once the array is freed. Returns NULL if maxval is
+   above 255 or the file cannot be created and mapped */
+extern A2Methods_UArray2 Ppmio_create(const char *path, int width,
+                                      int height, unsigned maxval);
+
+/* copies the image in in to out as P6, applying t, which must keep the
+   dimensions (identity, flips or 180 degree rotation), a chunk of rows at a
+   time. Memory is O(width) unless the rows have to be read backwards from
+   a P3 image or a pipe. Sets *width and *height to the image's size.
+   Raises Pnm_Badformat if in does not hold an image */
+extern void Ppmio_stream(FILE *in, FILE *out, D4_T t, int *width,
+                         int *height);
+
+/* writes pixmap as P6; its cells may be in any format of pixel.h */
+extern void Ppmio_write(FILE *fp, Pnm_ppm pixmap);
+
+/* writes the cells of pixels as P6 raster rows, with no header */
+extern void Ppmio_write_rows(FILE *fp, const struct A2Methods_T *methods,
+                             A2Methods_UArray2 pixels, unsigned maxval);
+
+#endif
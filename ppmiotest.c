@@ -0,0 +1,368 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "assert.h"
+#include "except.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2morton.h"
+#include "pnm.h"
+#include "pixel.h"
+#include "ppmio.h"
+
+typedef A2Methods_UArray2 A2;
+
+/* image sizes: one pixel, odd sizes that leave partial blocks, one row,
+   one column */
+static const int sizes[][2] = {
+        { 1, 1 }, { 5, 3 }, { 17, 9 }, { 64, 1 }, { 1, 40 }
+};
+#define NSIZES ((int)(sizeof(sizes) / sizeof(sizes[0])))
+
+/* maxvals on both sides of the 8-bit/16-bit boundary */
+static const unsigned maxvals[] = { 1, 255, 256, 65535 };
+#define NMAXVALS ((int)(sizeof(maxvals) / sizeof(maxvals[0])))
+
+/* sample c of pixel (i, j) of every test image */
+static unsigned sample(int i, int j, int c, unsigned maxval)
+{
+        return (i * 7919u + j * 104729u + c * 31u) % (maxval + 1);
+}
+
+/* an image as a P6 or P3 file, in memory */
+struct file {
+        char *bytes;
+        size_t length;
+};
+
+static struct file p6_file(int w, int h, unsigned maxval)
+{
+        struct file f;
+        int sample_bytes = maxval > 255 ? 2 : 1;
+        f.bytes = ALLOC(64 + (size_t)w * h * 3 * sample_bytes);
+        f.length = sprintf(f.bytes, "P6\n%d %d\n%u\n", w, h, maxval);
+        for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                        for (int c = 0; c < 3; c++) {
+                                unsigned v = sample(i, j, c, maxval);
+                                if (sample_bytes == 2) {
+                                        f.bytes[f.length++] = v >> 8;
+                                }
+                                f.bytes[f.length++] = v & 0xff;
+                        }
+                }
+        }
+        return f;
+}
+
+static struct file p3_file(int w, int h, unsigned maxval)
+{
+        struct file f;
+        f.bytes = ALLOC(64 + (size_t)w * h * 3 * 6 + h * 16);
+        f.length = sprintf(f.bytes, "P3\n# a comment\n%d %d\n%u\n", w, h,
+                           maxval);
+        for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                        for (int c = 0; c < 3; c++) {
+                                f.length += sprintf(f.bytes + f.length,
+                                                    "%u ",
+                                                    sample(i, j, c, maxval));
+                        }
+                }
+                f.bytes[f.length++] = '\n';
+        }
+        return f;
+}
+
+/* a stream holding the given bytes */
+static FILE *open_bytes(const char *bytes, size_t length)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        assert(fwrite(bytes, 1, length, fp) == length);
+        rewind(fp);
+        return fp;
+}
+
+/* a file holding the given bytes; the caller removes it */
+static char *save_bytes(const char *bytes, size_t length)
+{
+        char *path = ALLOC(32);
+        strcpy(path, "/tmp/ppmiotestXXXXXX");
+        int fd = mkstemp(path);
+        assert(fd >= 0);
+        assert(write(fd, bytes, length) == (ssize_t)length);
+        close(fd);
+        return path;
+}
+
+/* the image holds the test image, in cells of the size its maxval calls
+   for */
+static void check_image(Pnm_ppm p, int w, int h, unsigned maxval)
+{
+        assert((int)p->width == w && (int)p->height == h);
+        assert(p->denominator == maxval);
+        const struct A2Methods_T *methods = p->methods;
+        assert(methods->size(p->pixels) == Pixel_size(maxval));
+        for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                        void *cell = methods->at(p->pixels, i, j);
+                        unsigned rgb[3];
+                        if (maxval <= PIXEL_RGB8_MAXVAL) {
+                                Pixel_rgb8 *px = cell;
+                                rgb[0] = px->red;
+                                rgb[1] = px->green;
+                                rgb[2] = px->blue;
+                        } else {
+                                Pixel_rgb16 *px = cell;
+                                rgb[0] = px->red;
+                                rgb[1] = px->green;
+                                rgb[2] = px->blue;
+                        }
+                        for (int c = 0; c < 3; c++) {
+                                assert(rgb[c] == sample(i, j, c, maxval));
+                        }
+                }
+        }
+}
+
+/* Ppmio_write of the image gives exactly the expected P6 file */
+static void check_written(Pnm_ppm p, struct file expected)
+{
+        FILE *fp = tmpfile();
+        assert(fp != NULL);
+        Ppmio_write(fp, p);
+        fflush(fp);
+        assert((size_t)ftell(fp) == expected.length);
+        rewind(fp);
+        char *bytes = ALLOC(expected.length);
+        assert(fread(bytes, 1, expected.length, fp) == expected.length);
+        assert(memcmp(bytes, expected.bytes, expected.length) == 0);
+        FREE(bytes);
+        fclose(fp);
+}
+
+/* every image reads back, through stdio and through a mapping, as P6 and
+   as P3, into every layout, and is written back as the same P6 */
+static void test_round_trip(A2Methods_T methods)
+{
+        for (int s = 0; s < NSIZES; s++) {
+                int w = sizes[s][0], h = sizes[s][1];
+                for (int m = 0; m < NMAXVALS; m++) {
+                        unsigned maxval = maxvals[m];
+                        struct file p6 = p6_file(w, h, maxval);
+                        struct file p3 = p3_file(w, h, maxval);
+                        struct file sources[2] = { p6, p3 };
+                        for (int k = 0; k < 2; k++) {
+                                FILE *fp = open_bytes(sources[k].bytes,
+                                                      sources[k].length);
+                                Pnm_ppm p = Ppmio_read(fp, methods);
+                                fclose(fp);
+                                check_image(p, w, h, maxval);
+                                check_written(p, p6);
+                                Pnm_ppmfree(&p);
+
+                                char *path = save_bytes(sources[k].bytes,
+                                                        sources[k].length);
+                                p = Ppmio_map(path, methods);
+                                assert(p != NULL);
+                                check_image(p, w, h, maxval);
+                                check_written(p, p6);
+                                Pnm_ppmfree(&p);
+                                unlink(path);
+                                FREE(path);
+                        }
+                        FREE(p6.bytes);
+                        FREE(p3.bytes);
+                }
+        }
+}
+
+/* an array of the course's wide struct Pnm_rgb cells is written as the
+   same P6 as a packed one */
+static void test_wide_cells(void)
+{
+        A2Methods_T methods = uarray2_methods_plain;
+        for (int m = 0; m < NMAXVALS; m++) {
+                unsigned maxval = maxvals[m];
+                int w = 6, h = 4;
+                struct Pnm_ppm p = {
+                        .width = w, .height = h, .denominator = maxval,
+                        .pixels = methods->new(w, h, sizeof(struct Pnm_rgb)),
+                        .methods = methods
+                };
+                for (int j = 0; j < h; j++) {
+                        for (int i = 0; i < w; i++) {
+                                struct Pnm_rgb *px = methods->at(p.pixels,
+                                                                 i, j);
+                                px->red = sample(i, j, 0, maxval);
+                                px->green = sample(i, j, 1, maxval);
+                                px->blue = sample(i, j, 2, maxval);
+                        }
+                }
+                struct file p6 = p6_file(w, h, maxval);
+                check_written(&p, p6);
+                FREE(p6.bytes);
+                methods->free(&p.pixels);
+        }
+}
+
+/* Ppmio_read_next reads frames of different sizes back to back, reusing
+   the array when the size repeats, and stops at trailing whitespace */
+static void test_frames(void)
+{
+        struct file frames[3] = {
+                p6_file(5, 3, 255), p6_file(5, 3, 255), p3_file(4, 7, 65535)
+        };
+        size_t length = 0;
+        for (int k = 0; k < 3; k++) {
+                length += frames[k].length;
+        }
+        char *bytes = ALLOC(length + 2);
+        length = 0;
+        for (int k = 0; k < 3; k++) {
+                memcpy(bytes + length, frames[k].bytes, frames[k].length);
+                length += frames[k].length;
+        }
+        bytes[length++] = '\n';
+        bytes[length++] = '\n';
+
+        FILE *fp = open_bytes(bytes, length);
+        Pnm_ppm p = NULL;
+        assert(Ppmio_read_next(fp, uarray2_methods_plain, &p));
+        check_image(p, 5, 3, 255);
+        A2 first = p->pixels;
+        assert(Ppmio_read_next(fp, uarray2_methods_plain, &p));
+        check_image(p, 5, 3, 255);
+        assert(p->pixels == first);
+        assert(Ppmio_read_next(fp, uarray2_methods_plain, &p));
+        check_image(p, 4, 7, 65535);
+        assert(!Ppmio_read_next(fp, uarray2_methods_plain, &p));
+        Pnm_ppmfree(&p);
+        fclose(fp);
+        FREE(bytes);
+        for (int k = 0; k < 3; k++) {
+                FREE(frames[k].bytes);
+        }
+}
+
+/* Ppmio_scan_next reports a frame, a malformed frame and the end of the
+   stream by its return code, and Ppmio_scan_map a mapped image, a
+   malformed one and a file it cannot map, without raising */
+static void test_scan(void)
+{
+        struct file frame = p6_file(5, 3, 255);
+        FILE *fp = open_bytes(frame.bytes, frame.length);
+        Pnm_ppm p = NULL;
+        assert(Ppmio_scan_next(fp, uarray2_methods_plain, &p) == 1);
+        check_image(p, 5, 3, 255);
+        assert(Ppmio_scan_next(fp, uarray2_methods_plain, &p) == 0);
+        fclose(fp);
+
+        fp = open_bytes(frame.bytes, frame.length - 1);
+        assert(Ppmio_scan_next(fp, uarray2_methods_plain, &p) == -1);
+        fclose(fp);
+        const char *above = "P3\n2 1\n255\n1 2 3 300 5 6\n";
+        fp = open_bytes(above, strlen(above));
+        assert(Ppmio_scan_next(fp, uarray2_methods_blocked, &p) == -1);
+        fclose(fp);
+        const char *magic = "P5\n1 1\n255\nabc";
+        fp = open_bytes(magic, strlen(magic));
+        assert(Ppmio_scan_next(fp, uarray2_methods_plain, &p) == -1);
+        fclose(fp);
+        if (p != NULL) {
+                Pnm_ppmfree(&p);
+        }
+
+        char *path = save_bytes(frame.bytes, frame.length);
+        assert(Ppmio_scan_map(path, uarray2_methods_plain, &p) == 1);
+        check_image(p, 5, 3, 255);
+        Pnm_ppmfree(&p);
+        unlink(path);
+        FREE(path);
+        path = save_bytes(frame.bytes, frame.length - 1);
+        assert(Ppmio_scan_map(path, uarray2_methods_blocked, &p) == -1);
+        unlink(path);
+        FREE(path);
+        path = save_bytes(above, strlen(above));
+        assert(Ppmio_scan_map(path, uarray2_methods_plain, &p) == -1);
+        unlink(path);
+        FREE(path);
+        assert(Ppmio_scan_map("/nonexistent", uarray2_methods_plain,
+                              &p) == 0);
+        FREE(frame.bytes);
+}
+
+/* reading the bytes, through stdio and through a mapping, raises
+   Pnm_Badformat */
+static void check_rejected(const char *bytes, size_t length)
+{
+        volatile int raised = 0;
+        FILE *fp = open_bytes(bytes, length);
+        TRY
+                Pnm_ppm p = Ppmio_read(fp, uarray2_methods_plain);
+                Pnm_ppmfree(&p);
+        EXCEPT(Pnm_Badformat)
+                raised++;
+        END_TRY;
+        fclose(fp);
+
+        char *path = save_bytes(bytes, length);
+        TRY
+                Pnm_ppm p = Ppmio_map(path, uarray2_methods_plain);
+                Pnm_ppmfree(&p);
+        EXCEPT(Pnm_Badformat)
+                raised++;
+        END_TRY;
+        unlink(path);
+        FREE(path);
+        assert(raised == 2);
+}
+
+/* truncated images, samples above maxval and bad headers are rejected */
+static void test_malformed(void)
+{
+        struct file p6 = p6_file(17, 9, 255);
+        check_rejected(p6.bytes, p6.length - 1);
+        check_rejected(p6.bytes, 10);
+        FREE(p6.bytes);
+
+        p6 = p6_file(5, 3, 65535);
+        check_rejected(p6.bytes, p6.length - 1);
+        FREE(p6.bytes);
+
+        struct file p3 = p3_file(5, 3, 255);
+        check_rejected(p3.bytes, p3.length - 4);
+        FREE(p3.bytes);
+
+        const char *above = "P3\n2 1\n255\n1 2 3 300 5 6\n";
+        check_rejected(above, strlen(above));
+        const char *wide = "P3\n1 1\n255\n1 2 70000\n";
+        check_rejected(wide, strlen(wide));
+        const char *magic = "P5\n1 1\n255\nabc";
+        check_rejected(magic, strlen(magic));
+        const char *empty = "P6\n0 1\n255\n";
+        check_rejected(empty, strlen(empty));
+}
+
+int main(int argc, char *argv[])
+{
+        assert(argc == 1);
+        (void)argv;
+        for (int threads = 1; threads <= 3; threads += 2) {
+                Ppmio_set_threads(threads);
+                test_round_trip(uarray2_methods_plain);
+                test_round_trip(uarray2_methods_blocked);
+                test_round_trip(uarray2_methods_morton);
+                test_malformed();
+        }
+        test_wide_cells();
+        test_frames();
+        test_scan();
+        printf("Passed.\n");
+        return 0;
+}
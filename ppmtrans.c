@@ -18,17 +18,32 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <sys/stat.h>
 
 #include "assert.h"
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2morton.h"
+#include "uarray2b.h"
 #include "pnm.h"
+#include "d4.h"
+#include "ppmio.h"
+#include "outcore.h"
+#include "batch.h"
+#include "server.h"
 #include "transformations.h"
 #include "cputiming.h"
 
 /* declaration for open_or_die function */
 static FILE *open_or_die(char *fname, char *mode);
+static bool same_file(const char *a, const char *b);
+static void stream_image(char *file_name, char *out_file_name, D4_T t,
+                         size_t budget, FILE *time_file);
+
+/* memory budget of -stream for the transformations that exchange the
+   width and height, which go out of core, when -memory does not give one */
+#define STREAM_BUDGET ((size_t)64 << 20)
 
 #define SET_METHODS(METHODS, MAP, WHAT) do {                    \
         methods = (METHODS);                                    \
@@ -46,9 +61,14 @@ static void
 usage(const char *progname)
 {
         fprintf(stderr, "Usage: %s [-rotate <angle>] "
-                        "[-{row,col,block}-major] "
-                       "[-time time_file] "
-                        "[filename]\n",
+                        "[-flip {horizontal,vertical}] [-transpose] "
+                        "[-{row,col,block,morton}-major] "
+                        "[-hilbert] [-recursive] [-blocksize <n>] "
+                        "[-threads <n>] [-stream] [-frames] "
+                        "[-memory <MB>] "
+                       "[-time time_file] [-o out_file] "
+                        "[filename | -batch {list_file,dir} -o out_dir "
+                        "[-pipeline] | -serve socket]\n",
                         progname);
         exit(1);
 }
@@ -72,11 +92,21 @@ usage(const char *progname)
 int main(int argc, char *argv[])
 {
         FILE *fp              = NULL;
+        char *file_name       = NULL;
         char *time_file_name  = NULL;
+        char *out_file_name   = NULL;
+        char *batch_source    = NULL;
+        char *socket_path     = NULL;
         FILE *time_file       = NULL;
-        int rotation          = 0;
-        char flip             = ' ';
-        bool transpose        = false;
+        D4_T orientation      = D4_IDENTITY; /* product of the -rotate, */
+                                             /* -flip and -transpose seen */
+        bool hilbert          = false;
+        bool recursive        = false;
+        bool stream           = false;
+        bool pipelined        = false;
+        bool frames           = false;
+        size_t memory_budget  = 0;   /* bytes; 0 for no limit */
+        int threads           = 1;
         int i;
 
         /* default to UArray2 methods */
@@ -97,12 +127,44 @@ int main(int argc, char *argv[])
                 } else if (strcmp(argv[i], "-block-major") == 0) {
                         SET_METHODS(uarray2_methods_blocked, map_block_major,
                                     "block-major");
+                } else if (strcmp(argv[i], "-morton-major") == 0) {
+                        SET_METHODS(uarray2_methods_morton, map_default,
+                                    "morton-major");
+                } else if (strcmp(argv[i], "-hilbert") == 0) {
+                        /* applied below, once the array type is known */
+                        hilbert = true;
+                } else if (strcmp(argv[i], "-recursive") == 0) {
+                        /* cache-oblivious engine for the copy pass */
+                        recursive = true;
+                } else if (strcmp(argv[i], "-stream") == 0) {
+                        /* never hold the whole image, see below */
+                        stream = true;
+                } else if (strcmp(argv[i], "-frames") == 0) {
+                        /* the input is frames back to back, see below */
+                        frames = true;
+                } else if (strcmp(argv[i], "-pipeline") == 0) {
+                        /* overlap reading, transforming and writing */
+                        pipelined = true;
+                } else if (strcmp(argv[i], "-memory") == 0) {
+                        if (!(i + 1 < argc)) {      /* no budget */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        long mb = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || mb <= 0 || mb > 1048576) {
+                                fprintf(stderr, 
+                                        "Memory must be a positive number "
+                                        "of megabytes\n");
+                                usage(argv[0]);
+                        }
+                        /* transform in bounded memory, see below */
+                        memory_budget = (size_t)mb << 20;
                 } else if (strcmp(argv[i], "-rotate") == 0) {
                         if (!(i + 1 < argc)) {      /* no rotate value */
                                 usage(argv[0]);
                         }
                         char *endptr;
-                        rotation = strtol(argv[++i], &endptr, 10);
+                        int rotation = strtol(argv[++i], &endptr, 10);
                         if (!(rotation == 0 || rotation == 90 ||
                             rotation == 180 || rotation == 270)) {
                                 fprintf(stderr, 
@@ -112,11 +174,14 @@ int main(int argc, char *argv[])
                         if (!(*endptr == '\0')) {    /* Not a number */
                                 usage(argv[0]);
                         } else if (rotation == 90) {
-                                rotation = 90;
+                                orientation = D4_compose(orientation,
+                                                         D4_ROTATE_90);
                         } else if (rotation == 180) {
-                                rotation = 180;
+                                orientation = D4_compose(orientation,
+                                                         D4_ROTATE_180);
                         } else if (rotation == 270) {
-                                rotation = 270;
+                                orientation = D4_compose(orientation,
+                                                         D4_ROTATE_270);
                         }
                 } else if (strcmp(argv[i], "-flip") == 0) {
                         if (!(i + 1 < argc)) {      /* no flip specified */
@@ -130,18 +195,64 @@ int main(int argc, char *argv[])
                                 usage(argv[0]);
                         }
                         if (strcmp(flip_in, "horizontal") == 0) {
-                                flip = 'h';
+                                orientation = D4_compose(orientation,
+                                                         D4_FLIP_HORIZONTAL);
                         } else if (strcmp(flip_in, "vertical") == 0) {
-                                flip = 'v';
+                                orientation = D4_compose(orientation,
+                                                         D4_FLIP_VERTICAL);
+                        }
+                } else if (strcmp(argv[i], "-blocksize") == 0) {
+                        if (!(i + 1 < argc)) {      /* no blocksize value */
+                                usage(argv[0]);
+                        }
+                        char *endptr;
+                        long blocksize = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || blocksize <= 0 ||
+                            blocksize > 65536) {
+                                fprintf(stderr, 
+                                      "Blocksize must be a positive integer\n");
+                                usage(argv[0]);
+                        }
+                        /* used by every blocked array made from here on */
+                        UArray2b_set_default_blocksize(blocksize);
+                } else if (strcmp(argv[i], "-threads") == 0) {
+                        if (!(i + 1 < argc)) {      /* no thread count */
+                                usage(argv[0]);
                         }
+                        char *endptr;
+                        long n = strtol(argv[++i], &endptr, 10);
+                        if (*endptr != '\0' || n <= 0 || n > 1024) {
+                                fprintf(stderr, 
+                                        "Threads must be between 1 and 1024\n");
+                                usage(argv[0]);
+                        }
+                        threads = n;
                 } else if (strcmp(argv[i], "-transpose") == 0) {
-                        transpose = true;
+                        orientation = D4_compose(orientation, D4_TRANSPOSE);
                 } else if (strcmp(argv[i], "-time") == 0) {
                         if (!(i + 1 < argc)) {      /* no time file */
                                 usage(argv[0]);
                         }
                         /* Save time file name */
                         time_file_name = argv[++i];
+                } else if (strcmp(argv[i], "-batch") == 0) {
+                        if (!(i + 1 < argc)) {      /* no list or dir */
+                                usage(argv[0]);
+                        }
+                        /* Save the list file or directory of images */
+                        batch_source = argv[++i];
+                } else if (strcmp(argv[i], "-serve") == 0) {
+                        if (!(i + 1 < argc)) {      /* no socket path */
+                                usage(argv[0]);
+                        }
+                        /* Save the path of the socket to serve on */
+                        socket_path = argv[++i];
+                } else if (strcmp(argv[i], "-o") == 0) {
+                        if (!(i + 1 < argc)) {      /* no output file */
+                                usage(argv[0]);
+                        }
+                        /* Save output file name */
+                        out_file_name = argv[++i];
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n", argv[0],
                                 argv[i]);
@@ -151,43 +262,185 @@ int main(int argc, char *argv[])
                         usage(argv[0]);
                 } else {
                         /* The last argument is the file name */
-                        fp = open_or_die(argv[i], "r");
+                        file_name = argv[i];
                 }
         }
 
-        /* If no file has been provided, read from standard input */
-        if (fp == NULL) {
-                fp = stdin;
+        /* Walk cells (blocks for -block-major) along a Hilbert curve */
+        if (hilbert) {
+                map = methods->map_hilbert;
+                if (map == NULL) {
+                        fprintf(stderr, "%s does not support Hilbert "
+                                        "mapping\n", argv[0]);
+                        exit(1);
+                }
+        }
+
+        /* With -batch, every image of the list goes to the -o directory */
+        if (batch_source != NULL) {
+                if (out_file_name == NULL || file_name != NULL ||
+                    stream || frames || memory_budget > 0) {
+                        fprintf(stderr, "-batch needs -o out_dir, and no "
+                                        "filename, -stream, -frames or "
+                                        "-memory\n");
+                        usage(argv[0]);
+                }
+                if (time_file_name != NULL) {
+                        time_file = open_or_die(time_file_name, "w");
+                }
+                int failed = Batch_run(batch_source, out_file_name,
+                                       orientation, methods, map, recursive,
+                                       threads, pipelined, time_file);
+                if (failed < 0) {
+                        fprintf(stderr, "Error: Could not read %s\n",
+                                batch_source);
+                }
+                if (time_file != NULL) {
+                        fclose(time_file);
+                }
+                return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        /* The pipeline overlaps the images of a batch; frames always
+           go through it */
+        if (pipelined && !frames) {
+                fprintf(stderr, "-pipeline needs -batch\n");
+                usage(argv[0]);
         }
 
+        /* Decode the input with the same number of threads */
+        Ppmio_set_threads(threads);
+
         /* Check and open time file, if already provided above */
         if (time_file_name != NULL) {
                 time_file = open_or_die(time_file_name, "w");
         }
 
-        /* Read the file and store the image */
-        Pnm_ppm p6 = Pnm_ppmread(fp, methods);
-        assert(p6 != NULL);
+        /* With -serve, each request brings its own transformation */
+        if (socket_path != NULL) {
+                if (file_name != NULL || out_file_name != NULL ||
+                    batch_source != NULL || frames || stream ||
+                    memory_budget > 0 || orientation != D4_IDENTITY) {
+                        fprintf(stderr, "-serve takes the transformation "
+                                        "and image from each request\n");
+                        usage(argv[0]);
+                }
+                if (Server_run(socket_path, methods, map, recursive, threads,
+                               time_file) != 0) {
+                        fprintf(stderr, "Error: Could not serve on %s\n",
+                                socket_path);
+                        exit(EXIT_FAILURE);
+                }
+                if (time_file != NULL) {
+                        fclose(time_file);
+                }
+                return EXIT_SUCCESS;
+        }
 
-        /* Time to start rotating */
-        if (!transpose && flip == ' ') {
-                p6 = rotation_driver(rotation, methods, map, p6, time_file);
+        /* With -frames, transform each frame of the input as it comes */
+        if (frames) {
+                if (stream || memory_budget > 0 ||
+                    (file_name != NULL && out_file_name != NULL &&
+                     same_file(file_name, out_file_name))) {
+                        fprintf(stderr, "-frames needs an output other "
+                                        "than the input, and no -stream "
+                                        "or -memory\n");
+                        usage(argv[0]);
+                }
+                FILE *in = (file_name != NULL) ? open_or_die(file_name, "r")
+                                               : stdin;
+                FILE *out = (out_file_name != NULL)
+                            ? open_or_die(out_file_name, "w") : stdout;
+                Batch_frames(in, out, orientation, methods, map, recursive,
+                             threads, time_file);
+                if (in != stdin) {
+                        fclose(in);
+                }
+                if (out != stdout) {
+                        fclose(out);
+                }
+                if (time_file != NULL) {
+                        fclose(time_file);
+                }
+                return EXIT_SUCCESS;
+        }
+
+        /* Map the file into memory if possible, else read it with stdio. 
+           If no file has been provided, read from standard input. A file
+           that is also the output is copied in, since creating the output
+           truncates it */
+        bool in_place = file_name != NULL && out_file_name != NULL &&
+                        same_file(file_name, out_file_name);
+
+        /* A transformation that keeps the dimensions keeps every row
+           intact, so with -stream or -memory it never builds the image.
+           The others go through a scratch file, in the -memory budget or
+           in STREAM_BUDGET. Both need an output other than the input,
+           which they read while writing. Otherwise the image is held in
+           memory */
+        if (stream || memory_budget > 0) {
+                if (in_place) {
+                        fprintf(stderr, "-stream and -memory need an output "
+                                        "other than the input\n");
+                        usage(argv[0]);
+                }
+                if (memory_budget == 0) {
+                        memory_budget = STREAM_BUDGET;
+                }
+                stream_image(file_name, out_file_name, orientation,
+                             memory_budget, time_file);
+                if (time_file != NULL) {
+                        fclose(time_file);
+                }
+                return EXIT_SUCCESS;
         }
-        
-        /* Time to start flipping */
-        p6 = flip_driver(flip, methods, map, p6, time_file);
 
-        /* Time to transpose */
-        if (transpose) {
-                p6 = transpose_driver(methods, map, p6, time_file);
+        Pnm_ppm p6 = NULL;
+        if (file_name != NULL && !in_place) {
+                p6 = Ppmio_map(file_name, methods);
+        }
+        if (p6 == NULL) {
+                fp = (file_name != NULL) ? open_or_die(file_name, "r")
+                                         : stdin;
+                p6 = Ppmio_read(fp, methods);
+        }
+        assert(p6 != NULL);
+
+        /* With -o, map the output file and let the transformation write
+           its pixels straight into it */
+        A2Methods_UArray2 out = NULL;
+        if (out_file_name != NULL && !in_place) {
+                bool swaps = D4_swaps_dimensions(orientation);
+                out = Ppmio_create(out_file_name,
+                                   swaps ? p6->height : p6->width,
+                                   swaps ? p6->width : p6->height,
+                                   p6->denominator);
         }
 
-        /* Write pixelmap to standard output */
-        Pnm_ppmwrite(stdout, p6);
+        /* Apply every -rotate, -flip and -transpose, in order, as one pass */
+        if (out != NULL) {
+                p6 = output_driver(orientation, methods, map, recursive,
+                                   threads, p6, uarray2_methods_plain, out,
+                                   time_file);
+        } else {
+                p6 = transform_driver(orientation, methods, map, recursive,
+                                      threads, p6, time_file);
+        }
 
-        /* Close the input file, if provided */
-        if (fp != stdin) {
+        /* Close the input file, if provided, before the output replaces it */
+        if (fp != NULL && fp != stdin) {
                 fclose(fp);
+                fp = NULL;
+        }
+
+        /* Write pixelmap to the output file, unless the transformation
+           already did, or to standard output */
+        if (out == NULL && out_file_name != NULL) {
+                FILE *out_fp = open_or_die(out_file_name, "w");
+                Ppmio_write(out_fp, p6);
+                fclose(out_fp);
+        } else if (out == NULL) {
+                Ppmio_write(stdout, p6);
         }
 
         /* Close the time file, if provided */
@@ -195,7 +448,7 @@ int main(int argc, char *argv[])
                 fclose(time_file);
         }
 
-        /* Free the ppm map */
+        /* Free the ppm map, which unmaps and so completes any -o file */
         Pnm_ppmfree(&p6);
 
         return EXIT_SUCCESS;
@@ -224,3 +477,76 @@ static FILE *open_or_die(char *fname, char *mode)
         }
         return fp;
 }
+
+/************** stream_image *************
+ *
+ * Copies the input image to the output a strip at a time, without ever
+ * holding the whole image, and times the whole copy. A transformation
+ * that keeps the dimensions is streamed a chunk of rows at a time (see
+ * Ppmio_stream); one that exchanges them goes through a scratch file,
+ * holding about budget bytes of pixels (see Outcore_transform).
+ *
+ * Parameters:
+ *      char *file_name:     input file, or NULL for standard input
+ *      char *out_file_name: output file, or NULL for standard output
+ *      D4_T t:              the transformation
+ *      size_t budget:       memory budget in bytes for out-of-core work
+ *      FILE *time_file:     file to output the time to, or NULL
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      budget is positive if t exchanges the dimensions (throws a CRE if
+ *      not). A file that cannot be opened ends the program with an error
+ *      message.
+ *
+ ********************************************/
+static void stream_image(char *file_name, char *out_file_name, D4_T t,
+                         size_t budget, FILE *time_file)
+{
+        assert(budget > 0 || !D4_swaps_dimensions(t));
+        FILE *in = (file_name != NULL) ? open_or_die(file_name, "r")
+                                       : stdin;
+        FILE *out = (out_file_name != NULL) ? open_or_die(out_file_name, "w")
+                                            : stdout;
+
+        int width, height;
+        CPUTime_T timer = start_timer();
+        double wall_start = wall_clock();
+        if (D4_swaps_dimensions(t)) {
+                Outcore_transform(in, out, t, budget, &width, &height);
+        } else {
+                Ppmio_stream(in, out, t, &width, &height);
+        }
+        fflush(out);
+        double time_used = CPUTime_Stop(timer);
+        print_timer(time_used, wall_clock() - wall_start, time_file,
+                    width, height);
+        CPUTime_Free(&timer);
+
+        if (in != stdin) {
+                fclose(in);
+        }
+        if (out != stdout) {
+                fclose(out);
+        }
+}
+
+/************** bool same_file *************
+ *
+ * Checks whether two names refer to the same existing file
+ *
+ * Parameters:
+ *      const char *a:  the first file name
+ *      const char *b:  the second file name
+ * Returns:
+ *      true if both files exist and are the same file, false otherwise
+ * Expects:
+ *      Neither name is NULL
+ *
+ ********************************************/
+static bool same_file(const char *a, const char *b)
+{
+        struct stat sa, sb;
+        return stat(a, &sa) == 0 && stat(b, &sb) == 0 &&
+               sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
@@ -0,0 +1,609 @@
+/**************************************************************
+ *
+ *                     server.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements ppmtrans's server mode. Starting
+ *              ppmtrans for every image costs milliseconds of exec,
+ *              dynamic linking and allocator warm-up, more than the
+ *              transformation itself for a small image. The server pays
+ *              for them once. Its work pool is started before the first
+ *              request, and the main thread hands each connection it
+ *              accepts to one of SERVER_WORKERS connection workers,
+ *              persistent threads that serve connections side by side.
+ *              Each worker keeps one source and one destination array from
+ *              request to request, so a run of same-size images allocates
+ *              nothing after the first. The workers' transformations, each
+ *              with every -threads thread, take turns on the shared pool.
+ *              The handlers of Hanson's exceptions form a single,
+ *              process-wide stack that only one thread may use, so nothing
+ *              a worker calls raises: an image that cannot be read is
+ *              reported by Ppmio_scan_next's return code. Every request
+ *              has REQUEST_TIMEOUT seconds, from the wait for its line to
+ *              the end of its reply; the main thread shuts down the
+ *              connection of one that takes longer, so a client that goes
+ *              quiet or trickles bytes holds its worker for no more than
+ *              that.
+ *
+ **************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "a2methods.h"
+#include "pnm.h"
+#include "d4.h"
+#include "ppmio.h"
+#include "workpool.h"
+#include "transformations.h"
+#include "cputiming.h"
+#include "server.h"
+
+typedef A2Methods_UArray2 A2; /* private abbreviation */
+
+/* connections served at once */
+#define SERVER_WORKERS 8
+
+/* seconds a request may take, from the wait for its line to the end of
+   its reply */
+#define REQUEST_TIMEOUT 30
+
+/* milliseconds between checks for requests past their deadline */
+#define WATCH_INTERVAL 1000
+
+struct server;
+
+/********** worker ********
+ *
+ * A connection worker: its thread, the arrays it keeps from one request
+ * to the next, and the connection it is serving with the deadline of its
+ * current request, which the main thread watches.
+ *
+ *******************/
+struct worker {
+        struct server *s;
+        pthread_t thread;
+        Pnm_ppm src;            /* the last image read, or NULL */
+        A2 dst;                 /* the last array transformed into */
+        int conn;               /* connection served, or -1 (s->lock) */
+        double deadline;        /* wall clock to answer by (s->lock) */
+};
+
+/********** server ********
+ *
+ * The server's settings, its workers, and the connections accepted but
+ * not yet taken by a worker.
+ *
+ *******************/
+struct server {
+        A2Methods_T methods;
+        A2Methods_mapfun *map;
+        bool recursive;
+        int threads;
+        FILE *time_file;
+
+        pthread_mutex_t lock;   /* guards everything below */
+        pthread_cond_t queued;  /* a connection was queued, or closing */
+        int pending[SERVER_WORKERS];
+        int head, count;        /* of the pending connections */
+        bool closing;           /* the workers are to finish */
+        int requests;           /* requests answered */
+        struct worker workers[SERVER_WORKERS];
+};
+
+/* the listening socket, and whether SIGINT or SIGTERM has come */
+static int listen_fd = -1;
+static volatile sig_atomic_t stopping = 0;
+
+/****************** stop *******************
+ *
+ * Handler of SIGINT and SIGTERM: shutting the listening socket down
+ * wakes the server from accept, whichever thread gets the signal.
+ *
+ ********************************************/
+static void stop(int sig)
+{
+        (void) sig;
+        stopping = 1;
+        shutdown(listen_fd, SHUT_RDWR);
+}
+
+/****************** parse_spec *******************
+ *
+ * Parses a request line: transformation options, as on the command line,
+ * then an optional path, which runs to the end of the line.
+ *
+ * Parameters:
+ *      char *line:  the request, without its newline
+ *      D4_T *t:     set to the product of the transformations
+ *      char **path: set to the path, or NULL if the image follows
+ * Returns:
+ *      NULL, or a message saying what is wrong with the request
+ *
+ ********************************************/
+static const char *parse_spec(char *line, D4_T *t, char **path)
+{
+        *t = D4_IDENTITY;
+        *path = NULL;
+        char *p = line;
+        for (;;) {
+                p += strspn(p, " \t");
+                if (*p == '\0') {
+                        return NULL;
+                }
+                if (*p != '-') {
+                        *path = p;
+                        return NULL;
+                }
+                char *option = p;
+                p += strcspn(p, " \t");
+                if (*p != '\0') {
+                        *p++ = '\0';
+                }
+                p += strspn(p, " \t");
+                char *arg = p;
+                if (strcmp(option, "-transpose") == 0) {
+                        *t = D4_compose(*t, D4_TRANSPOSE);
+                        continue;
+                }
+                p += strcspn(p, " \t");
+                if (*p != '\0') {
+                        *p++ = '\0';
+                }
+                if (strcmp(option, "-rotate") == 0) {
+                        if (strcmp(arg, "90") == 0) {
+                                *t = D4_compose(*t, D4_ROTATE_90);
+                        } else if (strcmp(arg, "180") == 0) {
+                                *t = D4_compose(*t, D4_ROTATE_180);
+                        } else if (strcmp(arg, "270") == 0) {
+                                *t = D4_compose(*t, D4_ROTATE_270);
+                        } else if (strcmp(arg, "0") != 0) {
+                                return "Rotation must be 0, 90 180 or 270";
+                        }
+                } else if (strcmp(option, "-flip") == 0) {
+                        if (strcmp(arg, "horizontal") == 0) {
+                                *t = D4_compose(*t, D4_FLIP_HORIZONTAL);
+                        } else if (strcmp(arg, "vertical") == 0) {
+                                *t = D4_compose(*t, D4_FLIP_VERTICAL);
+                        } else {
+                                return "Flip must be horizontal or vertical";
+                        }
+                } else {
+                        return "Unknown option";
+                }
+        }
+}
+
+/****************** set_deadline *******************
+ *
+ * Gives the connection a worker is serving REQUEST_TIMEOUT seconds from
+ * now for its next request.
+ *
+ ********************************************/
+static void set_deadline(struct worker *w)
+{
+        pthread_mutex_lock(&w->s->lock);
+        w->deadline = wall_clock() + REQUEST_TIMEOUT * 1e9;
+        pthread_mutex_unlock(&w->s->lock);
+}
+
+/****************** serve_request *******************
+ *
+ * Answers one request: reads the image, from the file named or from the
+ * connection, into the worker's source array, transforms it into its
+ * destination array and sends it back. The request is timed with the CPU
+ * timer and the wall clock, from the end of its line to the end of the
+ * reply. The CPU time is the process's, so it includes the work of the
+ * pool's threads and of requests served at the same time.
+ *
+ * Parameters:
+ *      struct worker *w: the worker serving the connection
+ *      char *line:       the request line, without its newline
+ *      FILE *in:         the connection, to read an image from
+ *      FILE *out:        the connection, to reply on
+ * Returns:
+ *      true if the connection can take another request, false if it may
+ *      be left in mid-image
+ *
+ ********************************************/
+static bool serve_request(struct worker *w, char *line, FILE *in, FILE *out)
+{
+        struct server *s = w->s;
+        D4_T t;
+        char *path;
+        const char *error = parse_spec(line, &t, &path);
+        if (error != NULL) {
+                /* an image may follow, and there is no telling its end */
+                fprintf(out, "ERR %s\n", error);
+                fflush(out);
+                return false;
+        }
+
+        CPUTime_T timer = start_timer();
+        double wall_start = wall_clock();
+
+        FILE *fp = in;
+        if (path != NULL) {
+                fp = fopen(path, "r");
+                if (fp == NULL) {
+                        fprintf(out, "ERR Could not open file %s\n", path);
+                        fflush(out);
+                        CPUTime_Free(&timer);
+                        return true;
+                }
+        }
+        bool ok = Ppmio_scan_next(fp, s->methods, &w->src) > 0;
+        if (fp != in) {
+                fclose(fp);
+        }
+        if (!ok) {
+                fprintf(out, "ERR Could not read image\n");
+                fflush(out);
+                CPUTime_Free(&timer);
+                return path != NULL;
+        }
+
+        /* the identity sends the source back as it is */
+        Pnm_ppm src = w->src;
+        struct Pnm_ppm result = *src;
+        if (t != D4_IDENTITY) {
+                bool swaps = D4_swaps_dimensions(t);
+                result.width = swaps ? src->height : src->width;
+                result.height = swaps ? src->width : src->height;
+                result.pixels = reuse_destination(s->methods, src->pixels,
+                                                  result.width,
+                                                  result.height, &w->dst);
+                copy_driver(t, s->methods, s->map, s->recursive,
+                            s->threads, src->pixels, s->methods,
+                            result.pixels, NULL);
+        }
+        Ppmio_write(out, &result);
+        fflush(out);
+
+        double time_used = CPUTime_Stop(timer);
+        double wall_time = wall_clock() - wall_start;
+        CPUTime_Free(&timer);
+        pthread_mutex_lock(&s->lock);
+        if (s->time_file != NULL) {
+                fprintf(s->time_file, "Request %d: %ux%u\n", s->requests,
+                        src->width, src->height);
+                print_timer(time_used, wall_time, s->time_file,
+                            src->width, src->height);
+                fflush(s->time_file);
+        }
+        s->requests++;
+        pthread_mutex_unlock(&s->lock);
+        return true;
+}
+
+/****************** serve_connection *******************
+ *
+ * Answers the requests of one connection until the client closes it,
+ * sends a request that leaves it in mid-image, or the main thread shuts
+ * it down because a request ran past its deadline or the server is
+ * stopping. The worker stops being the connection's before closing it,
+ * so the main thread never shuts down a descriptor that has been reused.
+ *
+ ********************************************/
+static void serve_connection(struct worker *w, int conn)
+{
+        int conn_out = dup(conn);
+        FILE *in = fdopen(conn, "r");
+        FILE *out = conn_out >= 0 ? fdopen(conn_out, "w") : NULL;
+        if (in == NULL || out == NULL) {
+                if (in != NULL) {
+                        fclose(in);
+                } else {
+                        close(conn);
+                }
+                if (out != NULL) {
+                        fclose(out);
+                } else if (conn_out >= 0) {
+                        close(conn_out);
+                }
+                return;
+        }
+
+        char *line = NULL;
+        size_t line_size = 0;
+        ssize_t len;
+        set_deadline(w);
+        while (!stopping && (len = getline(&line, &line_size, in)) != -1) {
+                while (len > 0 && (line[len - 1] == '\n' ||
+                                   line[len - 1] == '\r')) {
+                        line[--len] = '\0';
+                }
+                if (len == 0) {
+                        continue;
+                }
+                if (!serve_request(w, line, in, out)) {
+                        break;
+                }
+                set_deadline(w);
+        }
+        free(line);
+
+        pthread_mutex_lock(&w->s->lock);
+        w->conn = -1;
+        pthread_mutex_unlock(&w->s->lock);
+        fclose(in);
+        fclose(out);
+}
+
+/****************** work *******************
+ *
+ * Thread of a connection worker: serves the connections the main thread
+ * queues, one after another, until the server is closing.
+ *
+ ********************************************/
+static void *work(void *cl)
+{
+        struct worker *w = cl;
+        struct server *s = w->s;
+        for (;;) {
+                pthread_mutex_lock(&s->lock);
+                while (s->count == 0 && !s->closing) {
+                        pthread_cond_wait(&s->queued, &s->lock);
+                }
+                if (s->closing) {
+                        pthread_mutex_unlock(&s->lock);
+                        return NULL;
+                }
+                int conn = s->pending[s->head];
+                s->head = (s->head + 1) % SERVER_WORKERS;
+                s->count--;
+                /* the deadline is set with the connection, or the main
+                   thread could see the last one's and shut this down */
+                w->conn = conn;
+                w->deadline = wall_clock() + REQUEST_TIMEOUT * 1e9;
+                pthread_mutex_unlock(&s->lock);
+                serve_connection(w, conn);
+        }
+}
+
+/****************** expire *******************
+ *
+ * Shuts down every connection whose request is past its deadline, or
+ * every connection if the server is closing, so that the worker's reads
+ * and writes fail and it moves on.
+ *
+ ********************************************/
+static void expire(struct server *s)
+{
+        double now = wall_clock();
+        pthread_mutex_lock(&s->lock);
+        for (int k = 0; k < SERVER_WORKERS; k++) {
+                struct worker *w = &s->workers[k];
+                if (w->conn >= 0 && (s->closing || now > w->deadline)) {
+                        shutdown(w->conn, SHUT_RDWR);
+                }
+        }
+        pthread_mutex_unlock(&s->lock);
+}
+
+/****************** accept_connection *******************
+ *
+ * Accepts a waiting connection and queues it for a worker.
+ *
+ * Returns:
+ *      false if the listening socket has failed or been shut down
+ *
+ ********************************************/
+static bool accept_connection(struct server *s)
+{
+        int conn = accept(listen_fd, NULL, NULL);
+        if (conn < 0) {
+                return errno == EINTR || errno == EAGAIN ||
+                       errno == EWOULDBLOCK || errno == ECONNABORTED;
+        }
+        pthread_mutex_lock(&s->lock);
+        assert(s->count < SERVER_WORKERS);
+        s->pending[(s->head + s->count) % SERVER_WORKERS] = conn;
+        s->count++;
+        pthread_cond_signal(&s->queued);
+        pthread_mutex_unlock(&s->lock);
+        return true;
+}
+
+/****************** open_socket *******************
+ *
+ * Makes the listening socket, first removing a socket left at the path
+ * by an earlier server. Any other file there is left alone.
+ *
+ * Returns:
+ *      the socket, or -1 if it cannot be made
+ *
+ ********************************************/
+static int open_socket(const char *socket_path)
+{
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sun_family = AF_UNIX;
+        if (strlen(socket_path) >= sizeof addr.sun_path) {
+                errno = ENAMETOOLONG;
+                return -1;
+        }
+        strcpy(addr.sun_path, socket_path);
+
+        struct stat st;
+        if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+                unlink(socket_path);
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+                return -1;
+        }
+        if (bind(fd, (struct sockaddr *)&addr, sizeof addr) != 0 ||
+            listen(fd, SOMAXCONN) != 0) {
+                int err = errno;
+                close(fd);
+                errno = err;
+                return -1;
+        }
+        return fd;
+}
+
+/****************** start_workers *******************
+ *
+ * Starts the connection workers, with SIGINT and SIGTERM blocked in them
+ * so that the signals go to the main thread.
+ *
+ ********************************************/
+static void start_workers(struct server *s)
+{
+        sigset_t stops, old;
+        sigemptyset(&stops);
+        sigaddset(&stops, SIGINT);
+        sigaddset(&stops, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &stops, &old);
+        for (int k = 0; k < SERVER_WORKERS; k++) {
+                struct worker *w = &s->workers[k];
+                w->s = s;
+                w->src = NULL;
+                w->dst = NULL;
+                w->conn = -1;
+                w->deadline = 0;
+                int err = pthread_create(&w->thread, NULL, work, w);
+                assert(err == 0);
+        }
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+/****************** stop_workers *******************
+ *
+ * Closes the connections still queued, shuts down those being served,
+ * waits for the workers to finish and frees their arrays.
+ *
+ ********************************************/
+static void stop_workers(struct server *s)
+{
+        pthread_mutex_lock(&s->lock);
+        s->closing = true;
+        for (; s->count > 0; s->count--) {
+                close(s->pending[s->head]);
+                s->head = (s->head + 1) % SERVER_WORKERS;
+        }
+        pthread_cond_broadcast(&s->queued);
+        pthread_mutex_unlock(&s->lock);
+        expire(s);
+
+        for (int k = 0; k < SERVER_WORKERS; k++) {
+                struct worker *w = &s->workers[k];
+                pthread_join(w->thread, NULL);
+                if (w->src != NULL) {
+                        Pnm_ppmfree(&w->src);
+                }
+                if (w->dst != NULL) {
+                        s->methods->free(&w->dst);
+                }
+        }
+}
+
+/****************** Server_run *******************
+ *
+ * Serves requests on a Unix domain socket until SIGINT or SIGTERM. The
+ * work pool and the connection workers are started before the first
+ * request, so that no request pays for starting threads. The main thread
+ * accepts connections while a worker is free to take them, and checks the
+ * deadlines of the requests being served every WATCH_INTERVAL
+ * milliseconds. SIGPIPE is ignored: a client that goes away before its
+ * reply only ends its own connection.
+ *
+ * Parameters:
+ *      const char *socket_path: where to make the socket
+ *      A2Methods_T methods:     methods for the arrays
+ *      A2Methods_mapfun *map:   map function for the transformations
+ *      bool recursive:          use the cache-oblivious engine
+ *      int threads:             threads to read and transform with
+ *      FILE *time_file:         file for the time of each request, or
+ *                               NULL
+ * Returns:
+ *      0 once stopped, or -1 if the socket cannot be made, with errno
+ *      set
+ * Expects:
+ *      None of the pointers but time_file are NULL and threads is
+ *      positive (throws a CRE if not)
+ *
+ ********************************************/
+int Server_run(const char *socket_path, A2Methods_T methods,
+               A2Methods_mapfun *map, bool recursive, int threads,
+               FILE *time_file)
+{
+        assert(socket_path != NULL);
+        assert(methods != NULL && map != NULL && threads > 0);
+
+        listen_fd = open_socket(socket_path);
+        if (listen_fd < 0) {
+                return -1;
+        }
+        fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+        signal(SIGPIPE, SIG_IGN);
+        struct sigaction action;
+        memset(&action, 0, sizeof action);
+        action.sa_handler = stop;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+
+        if (threads > 1) {
+                Workpool_shared(threads);
+        }
+        struct server *s;
+        NEW(s);
+        s->methods = methods;
+        s->map = map;
+        s->recursive = recursive;
+        s->threads = threads;
+        s->time_file = time_file;
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->queued, NULL);
+        s->head = s->count = 0;
+        s->closing = false;
+        s->requests = 0;
+        start_workers(s);
+
+        bool listening = true;
+        while (!stopping && listening) {
+                /* with every worker busy and a connection waiting for
+                   each, leave the rest in the listen backlog */
+                pthread_mutex_lock(&s->lock);
+                bool full = s->count == SERVER_WORKERS;
+                pthread_mutex_unlock(&s->lock);
+
+                struct pollfd ready = { listen_fd, POLLIN, 0 };
+                int n = poll(&ready, full ? 0 : 1, WATCH_INTERVAL);
+                if (n > 0 && !stopping) {
+                        listening = accept_connection(s);
+                } else if (n < 0 && errno != EINTR) {
+                        listening = false;
+                }
+                expire(s);
+        }
+
+        stop_workers(s);
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path);
+        if (time_file != NULL) {
+                fprintf(time_file, "Requests served: %d\n", s->requests);
+        }
+        pthread_cond_destroy(&s->queued);
+        pthread_mutex_destroy(&s->lock);
+        FREE(s);
+        return 0;
+}
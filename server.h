@@ -0,0 +1,50 @@
+/**************************************************************
+ *
+ *                     server.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for ppmtrans's server mode, which keeps one
+ *              process, its threads and its arrays alive and transforms
+ *              the images sent to it over a Unix domain socket, so that a
+ *              request does not pay for starting a program.
+ *
+ *              A client connects and sends one or more requests. A request
+ *              is one line: any of -rotate <angle>, -flip <direction> and
+ *              -transpose, as on the command line, then the path of a P6 or
+ *              P3 file, or nothing if the image itself follows the line.
+ *              Empty lines are ignored, so a request for an image that
+ *              follows needs an option; -rotate 0 changes nothing. A P3
+ *              image sent this way must end in whitespace, or the server
+ *              cannot tell that its last number is complete. The reply is
+ *              the transformed image as P6, or a line starting "ERR " if it
+ *              could not be made.
+ *
+ *              Up to eight connections are served at once, each by one of
+ *              a fixed set of worker threads; more wait to be accepted. A
+ *              request has 30 seconds, counted from when the server starts
+ *              waiting for its line to the end of its reply, and the
+ *              connection is closed if it takes longer.
+ *
+ **************************************************************/
+
+#ifndef SERVER_INCLUDED
+#define SERVER_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "a2methods.h"
+
+/* serves requests on a Unix domain socket made at socket_path until the
+   process gets SIGINT or SIGTERM, then removes the socket. Images are
+   held in arrays made by methods and transformed with threads threads.
+   The time of each request goes to time_file if it is not NULL. Returns
+   0, or -1 if the socket cannot be made */
+extern int Server_run(const char *socket_path, A2Methods_T methods,
+                      A2Methods_mapfun *map, bool recursive, int threads,
+                      FILE *time_file);
+
+#endif
@@ -19,6 +19,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
 
 #include "assert.h"
 #include "a2methods.h"
@@ -26,7 +28,11 @@
 #include "a2blocked.h"
 #include "mem.h"
 #include "pnm.h"
+#include "pixel.h"
 #include "cputiming.h"
+#include "cotrans.h"
+#include "blocktrans.h"
+#include "partrans.h"
 #include "transformations.h"
 
 typedef A2Methods_UArray2 A2; /* private abbreviation */
@@ -35,166 +41,545 @@ typedef A2Methods_UArray2 A2; /* private abbreviation */
  * 
  * Struct for the closure pointer that will be passed to the map function.
  * The closure struct contains the new array that will store the transformed
- * pixels and the methods object that will be used to access the array.
+ * pixels and the methods object that will be used to access it. The new
+ * array need not use the same methods as the original: the -o output
+ * raster is always a plain UArray2.
  *
  *******************/
 typedef struct trans_closure {
         A2 new_array; /* New array to store transformed pixels */
-        A2Methods_T methods; /* Methods object */
+        A2Methods_T methods; /* Methods object for the new array */
+        int width, height; /* Dimensions of the original array */
+        int size; /* Cell size of both arrays, see pixel.h */
+        bool direct; /* The span kernels step through the new array */
+        long row_bytes; /* From a new cell to the one below, if direct */
+        int blocksize; /* Of the new array if blocked, else 0 */
 } *trans_closure;
 
-/****************** rotation_driver *******************
+/****************** resolve_destination *******************
  * 
- * Function to apply a rotation to a PPM image. The function will apply a
- * rotation of 90, 180, or 270 degrees to the image and return the modified
- * PPM. The function will also time the transformation and output the time to
- * a file if the time_file is not NULL.
+ * Function to record in the closure how the span kernels can walk the new
+ * array with pointers instead of calling at for every pixel. In a plain
+ * array, the cell below another is a row stride further on; in a blocked
+ * one, it is a block row further on, as long as the walk stays in the
+ * block. Other layouts, Morton order among them, are left to at.
  *
  * Parameters:
- *            int rotation: integer representing the rotation to be applied
- *     A2Methods_T methods: methods object to be used to access the array
- *   A2Methods_mapfun *map: map function to be used to apply the transformation
- *              Pnm_ppm p6: PPM image to be transformed
- *         FILE *time_file: file to output the time of the transformation
+ *    trans_closure cl: closure with the new array, its methods and the
+ *                      cell size filled in
  * Returns:
- *    The modified PPM image after the appropriate rotation has been applied
+ *    Nothing
+ *
+ ********************************************/
+static void resolve_destination(trans_closure cl)
+{
+        A2 new_arr = cl->new_array;
+        A2Methods_T methods = cl->methods;
+        cl->direct = false;
+        cl->row_bytes = 0;
+        cl->blocksize = 0;
+        if (methods == uarray2_methods_plain) {
+                cl->direct = true;
+                if (methods->height(new_arr) > 1) {
+                        cl->row_bytes = (char *)methods->at(new_arr, 0, 1) -
+                                        (char *)methods->at(new_arr, 0, 0);
+                }
+        } else if (methods == uarray2_methods_blocked) {
+                cl->direct = true;
+                cl->blocksize = methods->blocksize(new_arr);
+                cl->row_bytes = (long)cl->blocksize * cl->size;
+        }
+}
+
+/****************** new_destination *******************
+ * 
+ * Function to allocate the array a transformation writes into, with the
+ * source's cell format. A blocked destination gets the same blocksize as
+ * the source, so that every source block has a matching destination block
+ * for the tile-pair path.
+ *
+ * Parameters:
+ *     A2Methods_T methods: methods object for both arrays
+ *                A2 src:   original array
+ *             int width:   width of the new array
+ *            int height:   height of the new array
+ * Returns:
+ *    The new array of pixels
  * Expects:
- *    The passed-in rotation values will be either 0, 90, 180, or 270. 
- *    The methods object will not be NULL (throws a CRE if NULL).
- *    The map function will not be NULL (throws a CRE if NULL).
- *    The PPM image will not be NULL (throws a CRE if NULL).
+ *    The methods object and src will not be NULL (throws a CRE if NULL).
  *
  ********************************************/
-extern struct Pnm_ppm *rotation_driver(int rotation, A2Methods_T methods, 
-                        A2Methods_mapfun *map, Pnm_ppm p6, FILE *time_file)
+static A2 new_destination(A2Methods_T methods, A2 src, int width, int height)
 {
+        assert(methods != NULL && src != NULL);
+        int blocksize = methods->blocksize(src);
+        if (blocksize > 0) {
+                return methods->new_with_blocksize(width, height,
+                                                   methods->size(src),
+                                                   blocksize);
+        }
+        return methods->new(width, height, methods->size(src));
+}
+
+/****************** reuse_destination *******************
+ * 
+ * Function to keep the array a transformation writes into from one image
+ * to the next. The kept array is returned as it is if it has the given
+ * dimensions and src's cell size and blocksize; otherwise it is freed and
+ * replaced by a new one, as new_destination makes.
+ *
+ * Parameters:
+ *     A2Methods_T methods: methods object for both arrays
+ *                A2 src:   array about to be transformed
+ *             int width:   width of the transformed image
+ *            int height:   height of the transformed image
+ *              A2 *kept:   the array kept from the last image, or NULL;
+ *                          set to the array to use
+ * Returns:
+ *    The array to transform src into
+ * Expects:
+ *    None of the pointers will be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern A2 reuse_destination(A2Methods_T methods, A2 src, int width,
+                            int height, A2 *kept)
+{
+        assert(methods != NULL && src != NULL && kept != NULL);
+        if (*kept != NULL &&
+            (methods->width(*kept) != width ||
+             methods->height(*kept) != height ||
+             methods->size(*kept) != methods->size(src) ||
+             methods->blocksize(*kept) != methods->blocksize(src))) {
+                methods->free(kept);
+        }
+        if (*kept == NULL) {
+                *kept = new_destination(methods, src, width, height);
+        }
+        return *kept;
+}
+
+/****************** run_transform *******************
+ * 
+ * Function to copy the original array into the new array held in the
+ * closure, picking the fastest engine that honours the user's choices:
+ *
+ *   - with more than one thread, the multithreaded engine (partrans.c),
+ *     which runs the tile-pair engine where it applies and the
+ *     cache-oblivious one otherwise; tiles are copied in no fixed order,
+ *     so the user's map is not followed;
+ *   - with recursive set, the cache-oblivious engine (cotrans.c);
+ *   - for UArray2bs with matching blocksizes traversed in their default
+ *     order, the tile-pair engine (blocktrans.c), which copies each source
+ *     block straight into its destination block, or copies all the blocks
+ *     at once for the identity;
+ *   - when the requested map is the array's default traversal and the
+ *     methods provide map_spans, the span version of the transformation,
+ *     which for the identity is a memcpy per row or block row;
+ *   - otherwise the per-pixel apply function, mapped as before.
+ *
+ * The new array is written through the closure's methods, which may differ
+ * from those of the original; the tile-pair engine is only used when they
+ * match.
+ *
+ * Parameters:
+ *     A2Methods_T methods:          methods object for the original array
+ *   A2Methods_mapfun *map:          map function chosen by the user
+ *          bool recursive:          use the cache-oblivious engine
+ *             int threads:          number of threads to transform with
+ *                D4_T t:            the transformation being applied
+ *                  A2 array:        original array being transformed
+ *   A2Methods_applyfun *pixel_fun:  per-pixel transformation
+ *    A2Methods_spanfun *span_fun:   per-span transformation
+ *      trans_closure cl:            closure with the new array filled in
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    None of the pointers will be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+static void run_transform(A2Methods_T methods, A2Methods_mapfun *map,
+                          bool recursive, int threads, D4_T t, A2 array,
+                          A2Methods_applyfun *pixel_fun,
+                          A2Methods_spanfun *span_fun, trans_closure cl)
+{
+        assert(methods != NULL && map != NULL && array != NULL);
+        assert(cl != NULL);
+        assert(pixel_fun != NULL && span_fun != NULL);
+        A2 new_arr = cl->new_array;
+        A2Methods_T dst_methods = cl->methods;
+
+        /* Record the original dimensions and cell size once, not per pixel */
+        cl->width = methods->width(array);
+        cl->height = methods->height(array);
+        cl->size = methods->size(array);
+        resolve_destination(cl);
+
+        bool pairs = !recursive && methods == uarray2_methods_blocked &&
+                     dst_methods == methods &&
+                     map == methods->map_default &&
+                     methods->blocksize(array) == methods->blocksize(new_arr);
+        if (threads > 1) {
+                Par_transform(methods, array, dst_methods, new_arr, t, pairs,
+                              threads);
+        } else if (recursive) {
+                CO_transform(methods, array, dst_methods, new_arr, t);
+        } else if (pairs) {
+                Blocktrans_transform(array, new_arr, t);
+        } else if (methods->map_spans != NULL && 
+                   map == methods->map_default) {
+                methods->map_spans(array, span_fun, cl);
+        } else {
+                map(array, pixel_fun, cl);
+        }
+}
+
+/****************** kernels_for *******************
+ * 
+ * Function to look up the per-pixel and per-span kernels of a
+ * transformation, for the engines that go through the user's map.
+ *
+ * Parameters:
+ *                  D4_T t:          the transformation
+ *   A2Methods_applyfun **pixel_fun: set to its per-pixel kernel
+ *    A2Methods_spanfun **span_fun:  set to its per-span kernel
+ * Returns:
+ *    Nothing
+ *
+ ********************************************/
+static void kernels_for(D4_T t, A2Methods_applyfun **pixel_fun,
+                        A2Methods_spanfun **span_fun)
+{
+        switch (t) {
+        case D4_ROTATE_90:
+                *pixel_fun = rotate_90;
+                *span_fun = rotate_90_span;
+                return;
+        case D4_ROTATE_180:
+                *pixel_fun = rotate_180;
+                *span_fun = rotate_180_span;
+                return;
+        case D4_ROTATE_270:
+                *pixel_fun = rotate_270;
+                *span_fun = rotate_270_span;
+                return;
+        case D4_FLIP_HORIZONTAL:
+                *pixel_fun = flip_horizontal;
+                *span_fun = flip_horizontal_span;
+                return;
+        case D4_FLIP_VERTICAL:
+                *pixel_fun = flip_vertical;
+                *span_fun = flip_vertical_span;
+                return;
+        case D4_TRANSPOSE:
+                *pixel_fun = take_transpose;
+                *span_fun = transpose_span;
+                return;
+        case D4_TRANSVERSE:
+                *pixel_fun = take_transverse;
+                *span_fun = transverse_span;
+                return;
+        case D4_IDENTITY:
+                break;
+        }
+        *pixel_fun = take_identity;
+        *span_fun = identity_span;
+}
+
+/****************** transform *******************
+ * 
+ * Function to apply any one of the eight orientation changes to a PPM
+ * image, copying it into out when that is given and into a fresh array
+ * otherwise. The old pixels are freed unless keep is set. The
+ * transformation is timed, and the time is output to a file if the
+ * time_file is not NULL.
+ *
+ * Parameters:
+ *                  D4_T t:      the transformation to be applied
+ *     A2Methods_T methods:      methods object to be used to access the array
+ *   A2Methods_mapfun *map:      map function to apply the transformation
+ *          bool recursive:      use the cache-oblivious engine instead of map
+ *             int threads:      number of threads to transform with
+ *              Pnm_ppm p6:      PPM image to be transformed
+ *   A2Methods_T out_methods:    methods object for out
+ *                  A2 out:      array to copy into, or NULL
+ *               bool keep:      leave the old pixels to the caller
+ *         FILE *time_file:      file to output the time of the transformation
+ * Returns:
+ *    The modified PPM image after the transformation has been applied
+ * Expects:
+ *    methods, map and p6 will not be NULL (throws a CRE if NULL).
+ *    If out is given, so is out_methods, and out has the transformed
+ *    dimensions and the image's cell size.
+ *
+ ********************************************/
+static struct Pnm_ppm *transform(D4_T t, A2Methods_T methods,
+                        A2Methods_mapfun *map, bool recursive, int threads,
+                        Pnm_ppm p6, A2Methods_T out_methods, A2 out,
+                        bool keep, FILE *time_file)
+{
+        /* Check for NULL pointers */
         assert(methods != NULL);
         assert(map != NULL);
         assert(p6 != NULL);
+        assert(out == NULL || out_methods != NULL);
 
         /* Start the clock */
         CPUTime_T timer = start_timer();
-                
-        if (rotation == 90) {
-                /* Create a new closure struct */
-                trans_closure cl;
-                NEW(cl);
-
-                /* Fetch dimensions of original array */
-                int width = methods->width(p6->pixels);
-                int height = methods->height(p6->pixels);
-
-                /* Declare a new swapped dimension array */
-                A2 new_arr = methods->new(height, width, 
-                                                       sizeof(struct Pnm_rgb));
-                
-                /* Populate the closure struct with new array and time file */
-                cl->new_array = new_arr;
-                cl->methods = methods;
+        double wall_start = wall_clock();
 
-                /* Map the original array onto the new array, 
-                        applying the rotate 90 function */
-                map(p6->pixels, rotate_90, cl);
-
-                /* Deallocate the old pixel array */
-                methods->free(&(p6->pixels));
-
-                /* Set the new pixel array to the new array and dimensions */
-                p6->pixels = new_arr;
-                p6->width = height;
-                p6->height = width;
-
-                /* Stop the clock and calculate the CPU time */ 
-                double time_used = CPUTime_Stop(timer);
-                print_timer(time_used, time_file, width, height);
+        /* Fetch dimensions of original array */
+        int width = methods->width(p6->pixels);
+        int height = methods->height(p6->pixels);
 
-                /* Free the closure struct */
-                FREE(cl);
+        /* Without an out array, the identity leaves every pixel where it
+         * is: no pass at all */
+        if (t != D4_IDENTITY || out != NULL) {
+                /* Dimensions of the transformed image */
+                bool swaps = D4_swaps_dimensions(t);
+                int new_width = swaps ? height : width;
+                int new_height = swaps ? width : height;
 
-        } else if (rotation == 180) {
                 /* Create a new closure struct */
                 trans_closure cl;
                 NEW(cl);
 
-                /* Fetch dimensions of original array */
-                int width = methods->width(p6->pixels);
-                int height = methods->height(p6->pixels);
+                /* Declare the array the pixels are copied into */
+                A2 new_arr = out;
+                if (new_arr == NULL) {
+                        new_arr = new_destination(methods, p6->pixels,
+                                                  new_width, new_height);
+                        out_methods = methods;
+                }
 
-                /* Declare a new array of same dimensions */
-                A2 new_arr = methods->new(width, height, 
-                                                       sizeof(struct Pnm_rgb));
-
-                /* Populate the closure struct with new array and time file */
+                /* Populate the closure struct with new array and methods */
                 cl->new_array = new_arr;
-                cl->methods = methods;
+                cl->methods = out_methods;
 
-                /* Map over the array, applying the rotate 180 function */
-                map(p6->pixels, rotate_180, cl);
+                /* Copy the original array onto the new array */
+                A2Methods_applyfun *pixel_fun;
+                A2Methods_spanfun *span_fun;
+                kernels_for(t, &pixel_fun, &span_fun);
+                run_transform(methods, map, recursive, threads, t, 
+                              p6->pixels, pixel_fun, span_fun, cl);
 
-                /* Deallocate the old pixel array */
-                methods->free(&(p6->pixels));
+                /* Deallocate the old pixel array, unless it is kept */
+                if (!keep) {
+                        methods->free(&(p6->pixels));
+                }
 
-                /* Set the new pixel array to the new array */
+                /* Set the new pixel array to the new array and dimensions */
                 p6->pixels = new_arr;
-
-                /* Stop the clock and calculate the CPU time */
-                double time_used = CPUTime_Stop(timer);
-                print_timer(time_used, time_file, width, height);
+                p6->methods = out_methods;
+                p6->width = new_width;
+                p6->height = new_height;
 
                 /* Free the closure struct */
                 FREE(cl);
-        } else if (rotation == 270) {
-                /* Create a new closure struct */
-                trans_closure cl;
-                NEW(cl);
-
-                /* Fetch dimensions of original array */
-                int width = methods->width(p6->pixels);
-                int height = methods->height(p6->pixels);
+        }
 
-                /* Declare a new swapped dimension array */
-                A2 new_arr = methods->new(height, width, 
-                                                       sizeof(struct Pnm_rgb));
-                
-                /* Populate the closure struct with new array and time file */
-                cl->new_array = new_arr;
-                cl->methods = methods;
+        /* Stop the clock and calculate the CPU time */
+        double time_used = CPUTime_Stop(timer);
+        print_timer(time_used, wall_clock() - wall_start, time_file,
+                    width, height);
 
-                /* Map the original array onto the new array, 
-                        applying the rotate 90 function */
-                map(p6->pixels, rotate_270, cl);
+        /* Free the timer */
+        CPUTime_Free(&timer);
 
-                /* Deallocate the old pixel array */
-                methods->free(&(p6->pixels));
+        /* Return the modified PPM */
+        return p6;
+}
 
-                /* Set the new pixel array to the new array and dimensions */
-                p6->pixels = new_arr;
-                p6->width = height;
-                p6->height = width;
+/****************** transform_driver *******************
+ * 
+ * Function to apply any one of the eight orientation changes to a PPM
+ * image. A sequence of rotations, flips and transposes reduces to one of
+ * them (see D4_compose), so a whole sequence costs a single copy of the
+ * image, and the identity costs none. The function will also time the
+ * transformation and output the time to a file if the time_file is not
+ * NULL.
+ *
+ * Parameters:
+ *                  D4_T t: the transformation to be applied
+ *     A2Methods_T methods: methods object to be used to access the array
+ *   A2Methods_mapfun *map: map function to be used to apply the transformation
+ *          bool recursive: use the cache-oblivious engine instead of map
+ *             int threads: number of threads to transform with
+ *              Pnm_ppm p6: PPM image to be transformed
+ *         FILE *time_file: file to output the time of the transformation
+ * Returns:
+ *    The modified PPM image after the transformation has been applied
+ * Expects:
+ *    The methods object will not be NULL (throws a CRE if NULL).
+ *    The map function will not be NULL (throws a CRE if NULL).
+ *    The PPM image will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern struct Pnm_ppm *transform_driver(D4_T t, A2Methods_T methods,
+                        A2Methods_mapfun *map, bool recursive, int threads,
+                        Pnm_ppm p6, FILE *time_file)
+{
+        return transform(t, methods, map, recursive, threads, p6, NULL, NULL,
+                         false, time_file);
+}
 
-                /* Stop the clock and calculate the CPU time */
-                double time_used = CPUTime_Stop(timer);
-                print_timer(time_used, time_file, width, height);
+/****************** output_driver *******************
+ * 
+ * Function to apply any one of the eight orientation changes to a PPM
+ * image, writing the pixels straight into an output array supplied by the
+ * caller, such as the mapped raster of the output file (see Ppmio_create),
+ * instead of a fresh array that would then have to be written out. The
+ * identity still costs one copy, into out. On return the PPM's pixels are
+ * out and its methods out_methods. The function will also time the
+ * transformation and output the time to a file if the time_file is not
+ * NULL.
+ *
+ * Parameters:
+ *                  D4_T t:      the transformation to be applied
+ *     A2Methods_T methods:      methods object to be used to access the array
+ *   A2Methods_mapfun *map:      map function to apply the transformation
+ *          bool recursive:      use the cache-oblivious engine instead of map
+ *             int threads:      number of threads to transform with
+ *              Pnm_ppm p6:      PPM image to be transformed
+ *   A2Methods_T out_methods:    methods object for out
+ *                  A2 out:      array to copy the transformed image into
+ *         FILE *time_file:      file to output the time of the transformation
+ * Returns:
+ *    The modified PPM image after the transformation has been applied
+ * Expects:
+ *    None of the pointers except time_file will be NULL (throws a CRE if
+ *    NULL). out has the transformed dimensions and the image's cell size
+ *    (throws a CRE otherwise).
+ *
+ ********************************************/
+extern struct Pnm_ppm *output_driver(D4_T t, A2Methods_T methods,
+                        A2Methods_mapfun *map, bool recursive, int threads,
+                        Pnm_ppm p6, A2Methods_T out_methods, A2 out,
+                        FILE *time_file)
+{
+        assert(out_methods != NULL && out != NULL);
+        return transform(t, methods, map, recursive, threads, p6,
+                         out_methods, out, false, time_file);
+}
 
-                /* Free the closure struct */
-                FREE(cl);
+/****************** copy_driver *******************
+ * 
+ * Function to apply any one of the eight orientation changes to an array
+ * of pixels, copying them into an output array supplied by the caller and
+ * leaving the source untouched, so that both arrays can be used again for
+ * later images (see Pipeline_run). The identity costs one copy, into out.
+ * The function will also time the transformation and output the time to a
+ * file if the time_file is not NULL.
+ *
+ * Parameters:
+ *                  D4_T t:      the transformation to be applied
+ *     A2Methods_T methods:      methods object to be used to access src
+ *   A2Methods_mapfun *map:      map function to apply the transformation
+ *          bool recursive:      use the cache-oblivious engine instead of map
+ *             int threads:      number of threads to transform with
+ *                  A2 src:      pixels to be transformed
+ *   A2Methods_T out_methods:    methods object for out
+ *                  A2 out:      array to copy the transformed pixels into
+ *         FILE *time_file:      file to output the time of the transformation
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    None of the pointers except time_file will be NULL (throws a CRE if
+ *    NULL). out has the transformed dimensions and src's cell size
+ *    (throws a CRE otherwise).
+ *
+ ********************************************/
+extern void copy_driver(D4_T t, A2Methods_T methods, A2Methods_mapfun *map,
+                        bool recursive, int threads, A2 src,
+                        A2Methods_T out_methods, A2 out, FILE *time_file)
+{
+        assert(src != NULL && out_methods != NULL && out != NULL);
+        struct Pnm_ppm image = { .width = methods->width(src),
+                                 .height = methods->height(src),
+                                 .pixels = src, .methods = methods };
+        transform(t, methods, map, recursive, threads, &image, out_methods,
+                  out, true, time_file);
+}
 
+/****************** rotation_driver *******************
+ * 
+ * Function to apply a rotation to a PPM image. The function will apply a
+ * rotation of 90, 180, or 270 degrees to the image and return the modified
+ * PPM. The function will also time the transformation and output the time to
+ * a file if the time_file is not NULL.
+ *
+ * Parameters:
+ *            int rotation: integer representing the rotation to be applied
+ *     A2Methods_T methods: methods object to be used to access the array
+ *   A2Methods_mapfun *map: map function to be used to apply the transformation
+ *          bool recursive: use the cache-oblivious engine instead of map
+ *             int threads: number of threads to transform with
+ *              Pnm_ppm p6: PPM image to be transformed
+ *         FILE *time_file: file to output the time of the transformation
+ * Returns:
+ *    The modified PPM image after the appropriate rotation has been applied
+ * Expects:
+ *    The passed-in rotation values will be either 0, 90, 180, or 270. 
+ *    The methods object will not be NULL (throws a CRE if NULL).
+ *    The map function will not be NULL (throws a CRE if NULL).
+ *    The PPM image will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern struct Pnm_ppm *rotation_driver(int rotation, A2Methods_T methods, 
+                        A2Methods_mapfun *map, bool recursive, int threads,
+                        Pnm_ppm p6, FILE *time_file)
+{
+        /* Each rotation is one element of the dihedral group */
+        if (rotation == 90) {
+                return transform_driver(D4_ROTATE_90, methods, map, recursive,
+                                        threads, p6, time_file);
+        } else if (rotation == 180) {
+                return transform_driver(D4_ROTATE_180, methods, map,
+                                        recursive, threads, p6, time_file);
+        } else if (rotation == 270) {
+                return transform_driver(D4_ROTATE_270, methods, map,
+                                        recursive, threads, p6, time_file);
         } else if (rotation == 0) {
-                /* Fetch dimensions of original array */
-                int width = methods->width(p6->pixels);
-                int height = methods->height(p6->pixels);
-
-                /* Stop the clock and calculate the CPU time */
-                double time_used = CPUTime_Stop(timer);
-                print_timer(time_used, time_file, width, height);
+                return transform_driver(D4_IDENTITY, methods, map, recursive,
+                                        threads, p6, time_file);
         }
-        /* Free the timer */
-        CPUTime_Free(&timer);
-
-        /* Return the modified PPM */
+        /* Return the unmodified PPM */
         return p6;
 }
 
+/****************** take_identity *******************
+ * 
+ * Function to copy a pixel of a PPM image to the same spot in the new
+ * array, for the identity when it still has to be copied (into an output
+ * array, say). The function will be called by the map function.
+ *
+ * Parameters:
+ *            int col:      column index of the pixel
+ *            int row:      row index of the pixel
+ * A2Methods_UArray2 array: array to be copied
+ *     void *elem:          pointer to the pixel to be copied
+ *       void *cl:          closure pointer to struct of new array and
+ *                          methods object
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The elem pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void take_identity(int col, int row, A2 array, void *elem, void *cl)
+{
+        (void) array;
+
+        /* Check for NULL pointers */
+        assert(elem != NULL);
+        assert(cl != NULL);
+
+        /* Save the pixel to the same spot in the new array */
+        trans_closure closure = (trans_closure)cl;
+        void *new_elem = closure->methods->at(closure->new_array, col, row);
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
 /****************** rotate_90 *******************
  * 
  * Function to apply a 90 degree rotation to a PPM image. The function will
@@ -229,13 +614,13 @@ extern void rotate_90(int col, int row, A2 array, void *elem, void *cl)
         /* Dereference the methods object */
         A2Methods_T methods = closure->methods;
 
-        /* Fetch the height of the original array */
-        int org_height = methods->height(array);
+        /* Fetch the height of the original array, cached in the closure */
+        int org_height = closure->height;
 
         /* Save the pixel to the rotated spot in the new array */
-        struct Pnm_rgb *new_elem = methods->at(new_arr, 
+        void *new_elem = methods->at(new_arr, 
                                                     org_height - row - 1, col);
-        *new_elem = *(struct Pnm_rgb *)elem;
+        Pixel_copy(new_elem, elem, closure->size);
 }
 
 /****************** rotate_180 *******************
@@ -273,14 +658,194 @@ extern void rotate_180(int col, int row, A2 array, void *elem, void *cl)
         /* Dereference the methods object */
         A2Methods_T methods = closure->methods;
 
-        /* Fetch the height and width of the original array */
-        int width = methods->width(array);
-        int height = methods->height(array);
+        /* Fetch the dimensions of the original array, cached in the
+         * closure */
+        int width = closure->width;
+        int height = closure->height;
         
         /* Save the pixel to the rotated spot in the new array */
-        struct Pnm_rgb *new_elem = methods->at(new_arr, width - col - 1, 
+        void *new_elem = methods->at(new_arr, width - col - 1, 
                                                              height - row - 1);
-        *new_elem = *(struct Pnm_rgb *)elem;
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
+/*
+ * Span kernels. Each *_span function below is the per-pixel function of
+ * the same transformation, applied to a run of contiguous pixels of one
+ * row. They are passed to map_spans, so there is one call per row or block
+ * row rather than one per pixel. The pixels of a span land on a straight
+ * line of the new array, which copy_run walks.
+ */
+
+/****************** copy_run *******************
+ * 
+ * Function to copy a span of pixels to a line of the new array, starting
+ * at (col, row) and moving by (dcol, drow), one of the four unit steps,
+ * for each pixel. When the closure allows it, the start of the line is
+ * looked up once, or once per block it crosses, and the rest is reached
+ * by adding a fixed step; a line that runs forward along a row is one
+ * memcpy. Otherwise each pixel goes through at.
+ *
+ * Parameters:
+ *   trans_closure closure: closure of the transformation
+ *      const char *pixels: the span's pixels
+ *                 int len: number of pixels in the span
+ *        int col, int row: where the first pixel goes in the new array
+ *      int dcol, int drow: step from one pixel's spot to the next's
+ * Returns:
+ *    Nothing
+ *
+ ********************************************/
+static void copy_run(trans_closure closure, const char *pixels, int len,
+                     int col, int row, int dcol, int drow)
+{
+        A2 new_arr = closure->new_array;
+        int size = closure->size;
+        if (!closure->direct) {
+                A2Methods_Object *(*at)(A2, int, int) = closure->methods->at;
+                for (int k = 0; k < len; k++) {
+                        void *new_elem = at(new_arr, col + k * dcol,
+                                            row + k * drow);
+                        Pixel_copy(new_elem, pixels + (long)k * size, size);
+                }
+                return;
+        }
+
+        long step = (long)dcol * size + drow * closure->row_bytes;
+        int bs = closure->blocksize;
+        while (len > 0) {
+                /* Pixels before the line leaves the current block */
+                int run = len;
+                if (bs > 0) {
+                        int along = dcol != 0 ? col : row;
+                        int left = dcol + drow > 0 ? bs - along % bs
+                                                   : along % bs + 1;
+                        run = left < len ? left : len;
+                }
+
+                char *new_elem = closure->methods->at(new_arr, col, row);
+                if (step == size) {
+                        memcpy(new_elem, pixels, (size_t)run * size);
+                        pixels += (long)run * size;
+                } else {
+                        for (int k = 0; k < run; k++) {
+                                Pixel_copy(new_elem, pixels, size);
+                                new_elem += step;
+                                pixels += size;
+                        }
+                }
+                len -= run;
+                col += run * dcol;
+                row += run * drow;
+        }
+}
+
+/****************** identity_span *******************
+ * 
+ * Span version of take_identity. Copies a run of len contiguous pixels,
+ * columns col .. col + len - 1 of the given row, to the same spots in the
+ * new array: one memcpy per row of a plain array, or per block row of a
+ * blocked one.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be copied
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void identity_span(int col, int row, int len, A2 array,
+                          void *span, void *cl)
+{
+        (void) array;
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        /* The span stays where it is, in the same order */
+        copy_run((trans_closure)cl, span, len, col, row, 1, 0);
+}
+
+/****************** rotate_90_span *******************
+ * 
+ * Span version of rotate_90. Applies a 90 degree rotation to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the rotated spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void rotate_90_span(int col, int row, int len, A2 array, 
+                           void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span becomes part of a column, read downwards */
+        copy_run(closure, span, len, closure->height - row - 1, col, 0, 1);
+}
+
+/****************** rotate_180_span *******************
+ * 
+ * Span version of rotate_180. Applies a 180 degree rotation to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the rotated spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void rotate_180_span(int col, int row, int len, A2 array, 
+                            void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span becomes part of a row, read leftwards */
+        copy_run(closure, span, len, closure->width - col - 1,
+                 closure->height - row - 1, -1, 0);
 }
 
 /****************** rotate_270 *******************
@@ -318,13 +883,49 @@ extern void rotate_270(int col, int row, A2 array, void *elem, void *cl)
         /* Dereference the methods object */
         A2Methods_T methods = closure->methods;
 
-        /* Fetch the height of the original array */
-        int org_width = methods->width(array);
+        /* Fetch the width of the original array, cached in the closure */
+        int org_width = closure->width;
 
         /* Save the pixel to the rotated spot in the new array */
-        struct Pnm_rgb *new_elem = methods->at(new_arr, row, 
+        void *new_elem = methods->at(new_arr, row, 
                                                           org_width - col - 1);
-        *new_elem = *(struct Pnm_rgb *)elem;
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
+/****************** rotate_270_span *******************
+ * 
+ * Span version of rotate_270. Applies a 270 degree rotation to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the rotated spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void rotate_270_span(int col, int row, int len, A2 array, 
+                            void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span becomes part of a column, read upwards */
+        copy_run(closure, span, len, row, closure->width - col - 1, 0, -1);
 }
 
 /****************** flip_driver *******************
@@ -338,6 +939,7 @@ extern void rotate_270(int col, int row, A2 array, void *elem, void *cl)
  *               char flip: character representing the flip to be applied
  *     A2Methods_T methods: methods object to be used to access the array
  *   A2Methods_mapfun *map: map function to be used to apply the transformation
+ *             int threads: number of threads to transform with
  *              Pnm_ppm p6: PPM image to be transformed
  *         FILE *time_file: file to output the time of the transformation
  * Returns:
@@ -350,90 +952,19 @@ extern void rotate_270(int col, int row, A2 array, void *elem, void *cl)
  *
  ********************************************/
 extern struct Pnm_ppm *flip_driver(char flip, A2Methods_T methods, 
-                            A2Methods_mapfun *map, Pnm_ppm p6, FILE *time_file) 
+                            A2Methods_mapfun *map, int threads, Pnm_ppm p6,
+                            FILE *time_file) 
 {
-        /* Check for NULL pointers */
-        assert(methods != NULL);
-        assert(map != NULL);
-        assert(p6 != NULL);
-       
-        /* Start the clock */
-        CPUTime_T timer = start_timer();
-
         /* Apply the horizontal flip */
         if (flip == 'h') {
-                /* Create a new closure struct */
-                trans_closure cl;
-                NEW(cl);
-
-                /* Fetch dimensions of original array */
-                int width = methods->width(p6->pixels);
-                int height = methods->height(p6->pixels);
-
-                /* Declare a new swapped dimension array */
-                A2 new_arr = methods->new(width, height,
-                                                       sizeof(struct Pnm_rgb));
-                
-                /* Populate the closure struct with new array and time file */
-                cl->new_array = new_arr;
-                cl->methods = methods;
-
-                /* Map the original array onto the new array, 
-                        applying the flip horizontal function */
-                map(p6->pixels, flip_horizontal, cl);
-
-                /* Deallocate the old pixel array */
-                methods->free(&(p6->pixels));
-
-                /* Set the new pixel array to the new array */
-                p6->pixels = new_arr;
-
-                /* Free the closure struct */
-                FREE(cl);
-
-                /* Stop the clock and calculate the CPU time */
-                double time_used = CPUTime_Stop(timer);
-                print_timer(time_used, time_file, width, height);
-
+                return transform_driver(D4_FLIP_HORIZONTAL, methods, map,
+                                        false, threads, p6, time_file);
         /* Apply the vertical flip */
         } else if (flip == 'v') {
-                /* Create a new closure struct */
-                trans_closure cl;
-                NEW(cl);
-
-                /* Fetch dimensions of original array */
-                int width = methods->width(p6->pixels);
-                int height = methods->height(p6->pixels);
-
-                /* Declare a new array of same size as original */
-                A2 new_arr = methods->new(width, height,
-                                                       sizeof(struct Pnm_rgb));
-
-                /* Populate the closure struct with new array and time file */
-                cl->new_array = new_arr;
-                cl->methods = methods;
-
-                /* Map the original array onto the new array, 
-                        applying the flip vertical */
-                map(p6->pixels, flip_vertical, cl);
-
-                /* Deallocate the old pixel array */
-                methods->free(&(p6->pixels));
-
-                /* Set the new pixel array to the new array */
-                p6->pixels = new_arr;
-
-                /* Free the closure struct */
-                FREE(cl);
-
-                /* Stop the clock and calculate the CPU time */
-                double time_used = CPUTime_Stop(timer);
-                print_timer(time_used, time_file, width, height);
+                return transform_driver(D4_FLIP_VERTICAL, methods, map,
+                                        false, threads, p6, time_file);
         }
-        /* Free the timer */
-        CPUTime_Free(&timer);
-
-        /* Return the modified PPM */
+        /* Return the unmodified PPM */
         return p6;
 }
 
@@ -472,13 +1003,49 @@ extern void flip_horizontal(int col, int row, A2 array, void *elem, void *cl)
         /* Dereference the methods object */
         A2Methods_T methods = closure->methods;
 
-        /* Fetch the height of the original array */
-        int org_width = methods->width(array);
+        /* Fetch the width of the original array, cached in the closure */
+        int org_width = closure->width;
 
         /* Save the pixel to the flipped spot in the new array */
-        struct Pnm_rgb *new_elem = methods->at(new_arr, 
+        void *new_elem = methods->at(new_arr, 
                                                      org_width - col - 1, row);
-        *new_elem = *(struct Pnm_rgb *)elem;
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
+/****************** flip_horizontal_span *******************
+ * 
+ * Span version of flip_horizontal. Applies a horizontal flip to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the flipped spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void flip_horizontal_span(int col, int row, int len, A2 array, 
+                                 void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span stays in its row, read leftwards */
+        copy_run(closure, span, len, closure->width - col - 1, row, -1, 0);
 }
 
 /****************** flip_vertical *******************
@@ -516,13 +1083,49 @@ extern void flip_vertical(int col, int row, A2 array, void *elem, void *cl)
         /* Dereference the methods object */
         A2Methods_T methods = closure->methods;
 
-        /* Fetch the height of the original array */
-        int org_height = methods->height(array);
+        /* Fetch the height of the original array, cached in the closure */
+        int org_height = closure->height;
 
         /* Save the pixel to the flipped spot in the new array */
-        struct Pnm_rgb *new_elem = methods->at(new_arr, col, 
+        void *new_elem = methods->at(new_arr, col, 
                                                          org_height - row - 1);
-        *new_elem = *(struct Pnm_rgb *)elem;
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
+/****************** flip_vertical_span *******************
+ * 
+ * Span version of flip_vertical. Applies a vertical flip to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the flipped spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void flip_vertical_span(int col, int row, int len, A2 array, 
+                               void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span moves to the mirrored row, in the same order */
+        copy_run(closure, span, len, col, closure->height - row - 1, 1, 0);
 }
 
 /****************** transpose_driver *******************
@@ -534,6 +1137,8 @@ extern void flip_vertical(int col, int row, A2 array, void *elem, void *cl)
  * Parameters:
  *     A2Methods_T methods: methods object to be used to access the array
  *   A2Methods_mapfun *map: map function to be used to apply the transformation
+ *          bool recursive: use the cache-oblivious engine instead of map
+ *             int threads: number of threads to transform with
  *              Pnm_ppm p6: PPM image to be transformed
  *         FILE *time_file: file to output the time of the transformation
  * Returns:
@@ -545,55 +1150,11 @@ extern void flip_vertical(int col, int row, A2 array, void *elem, void *cl)
  *
  ********************************************/
 extern struct Pnm_ppm *transpose_driver(A2Methods_T methods, 
-                            A2Methods_mapfun *map, Pnm_ppm p6, FILE *time_file)
+                            A2Methods_mapfun *map, bool recursive, int threads,
+                            Pnm_ppm p6, FILE *time_file)
 {
-        /* Check for NULL pointers */
-        assert(methods != NULL);
-        assert(map != NULL);
-        assert(p6 != NULL);
-
-        /* Start the clock */
-        CPUTime_T timer = start_timer();
-
-        /* Create a new closure struct */
-        trans_closure cl;
-        NEW(cl);
-
-        /* Fetch dimensions of original array */
-        int width = methods->width(p6->pixels);
-        int height = methods->height(p6->pixels);
-
-        /* Declare a new swapped dimension array */
-        A2 new_arr = methods->new(height, width, sizeof(struct Pnm_rgb));
-
-        /* Populate the closure struct with new array and time file */
-        cl->new_array = new_arr;
-        cl->methods = methods;
-
-        /* Map the original array onto the new array, 
-                applying the rotate 90 function */
-        map(p6->pixels, take_transpose, cl);
-
-        /* Deallocate the old pixel array */
-        methods->free(&(p6->pixels));
-
-        /* Set the new pixel array to the new array and dimensions */
-        p6->pixels = new_arr;
-        p6->width = height;
-        p6->height = width;
-
-        /* Free the closure struct */
-        FREE(cl);
-
-        /* Stop the clock and calculate the CPU time */
-        double time_used = CPUTime_Stop(timer);
-        print_timer(time_used, time_file, width, height);
-
-        /* Free the timer */
-        CPUTime_Free(&timer);
-
-        /* Return the modified PPM */
-        return p6;
+        return transform_driver(D4_TRANSPOSE, methods, map, recursive,
+                                threads, p6, time_file);
 }
 
 /****************** take_transpose *******************
@@ -633,8 +1194,125 @@ extern void take_transpose(int col, int row, A2Methods_UArray2 array,
         A2Methods_T methods = closure->methods;
 
         /* Save the pixel to the transposed spot in the new array */
-        struct Pnm_rgb *new_elem = methods->at(new_arr, row, col);
-        *new_elem = *(struct Pnm_rgb *)elem;
+        void *new_elem = methods->at(new_arr, row, col);
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
+/****************** transpose_span *******************
+ * 
+ * Span version of take_transpose. Applies a transpose to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the transposed spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void transpose_span(int col, int row, int len, A2 array, 
+                           void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span becomes part of a column, read downwards */
+        copy_run(closure, span, len, row, col, 0, 1);
+}
+
+/****************** take_transverse *******************
+ * 
+ * Function to apply a transverse (a transpose across the other diagonal,
+ * from the top-right to the bottom-left corner) to a PPM image. The
+ * function will be called by the map function and will save the pixel to
+ * the transversed spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the pixel
+ *            int row:      row index of the pixel
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *elem:          pointer to the pixel to be transformed
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The elem pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void take_transverse(int col, int row, A2Methods_UArray2 array,
+                                                          void *elem, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(elem != NULL);
+        assert(cl != NULL);
+
+        /* From the closure struct, dereference to obtain the A2 object */
+        trans_closure closure = (trans_closure)cl;
+        A2 new_arr = closure->new_array;
+
+        /* Dereference the methods object */
+        A2Methods_T methods = closure->methods;
+
+        /* Save the pixel to the transversed spot in the new array */
+        void *new_elem = methods->at(new_arr, 
+                                               closure->height - row - 1,
+                                               closure->width - col - 1);
+        Pixel_copy(new_elem, elem, closure->size);
+}
+
+/****************** transverse_span *******************
+ * 
+ * Span version of take_transverse. Applies a transverse to a run of len
+ * contiguous pixels, columns col .. col + len - 1 of the given row, saving
+ * each pixel to the transversed spot in the new array.
+ *
+ * Parameters:
+ *            int col:      column index of the first pixel in the span
+ *            int row:      row index of the span
+ *            int len:      number of pixels in the span
+ * A2Methods_UArray2 array: array to be transformed
+ *     void *span:          pointer to the first pixel of the span
+ *       void *cl:          closure pointer to struct of new array,
+ *                          methods object and original dimensions
+ * Returns:
+ *    Nothing
+ * Expects:
+ *    The span pointer will not be NULL (throws a CRE if NULL).
+ *    The closure pointer will not be NULL (throws a CRE if NULL).
+ *
+ ********************************************/
+extern void transverse_span(int col, int row, int len, A2 array, 
+                            void *span, void *cl)
+{
+        (void) array; /* Dimensions are cached in the closure */
+
+        /* Check for NULL pointers */
+        assert(span != NULL);
+        assert(cl != NULL);
+
+        trans_closure closure = (trans_closure)cl;
+
+        /* The span becomes part of a column, read upwards */
+        copy_run(closure, span, len, closure->height - row - 1,
+                 closure->width - col - 1, 0, -1);
 }
 
 /****************** start_timer *******************
@@ -662,13 +1340,34 @@ extern CPUTime_T start_timer()
         return timer;
 }
 
+/****************** wall_clock *******************
+ * 
+ * Function to read the wall clock. CPU time adds up the time of every
+ * thread, so with -threads it is the wall clock that shows the speedup.
+ *
+ * Parameters:
+ *    Nothing
+ * Returns:
+ *    Nanoseconds on a monotonic clock, from an arbitrary starting point
+ * Expects:
+ *    Nothing
+ *
+ ********************************************/
+extern double wall_clock()
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (double)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
 /****************** print_timer *******************
  * 
  * Function to print the time to a file and output the time per pixel to the
- * file.
+ * file. The CPU time is the total over all threads of the process.
  *
  * Parameters:
- *             double time:  time to be printed
+ *             double time:  CPU time to be printed
+ *        double wall_time:  wall-clock time to be printed
  *         FILE *time_file:  file to output the time
  *               int width:  width of the image
  *              int height:  height of the image
@@ -678,7 +1377,8 @@ extern CPUTime_T start_timer()
  *    The time_file will not be NULL. If not, function will not do anything.
  *
  ********************************************/
-extern void print_timer(double time, FILE *time_file, int width, int height)
+extern void print_timer(double time, double wall_time, FILE *time_file,
+                        int width, int height)
 {
         /* Stop the clock and calculate the CPU time */
         if (time_file != NULL) {
@@ -686,5 +1386,10 @@ extern void print_timer(double time, FILE *time_file, int width, int height)
                 "CPU time for transformation: %f nanoseconds\n", time);
                 fprintf(time_file, "Time per pixel: %fs\n",
                         time / (width * height));
+                fprintf(time_file, 
+                "Wall-clock time for transformation: %f nanoseconds\n",
+                        wall_time);
+                fprintf(time_file, "Wall-clock time per pixel: %f ns\n",
+                        wall_time / (width * height));
         }
 }
@@ -16,25 +16,58 @@
 #ifndef TRANSFORMATIONS_H
 #define TRANSFORMATIONS_H
 
+#include <stdbool.h>
+
 #include "cputiming.h"
+#include "d4.h"
+
+/*****************************************************************
+ *                  General Driver Declaration
+ *****************************************************************/
+extern struct Pnm_ppm *transform_driver(D4_T t, A2Methods_T methods,
+                           A2Methods_mapfun *map, bool recursive, int threads,
+                           Pnm_ppm p6, FILE *time_file);
+extern struct Pnm_ppm *output_driver(D4_T t, A2Methods_T methods,
+                           A2Methods_mapfun *map, bool recursive, int threads,
+                           Pnm_ppm p6, A2Methods_T out_methods,
+                           A2Methods_UArray2 out, FILE *time_file);
+extern A2Methods_UArray2 reuse_destination(A2Methods_T methods,
+                           A2Methods_UArray2 src, int width, int height,
+                           A2Methods_UArray2 *kept);
+extern void copy_driver(D4_T t, A2Methods_T methods, A2Methods_mapfun *map,
+                           bool recursive, int threads, A2Methods_UArray2 src,
+                           A2Methods_T out_methods, A2Methods_UArray2 out,
+                           FILE *time_file);
 
 /*****************************************************************
  *                  Rotation Function Declarations
  *****************************************************************/
 extern struct Pnm_ppm *rotation_driver(int rotation, A2Methods_T methods, 
-                           A2Methods_mapfun *map, Pnm_ppm p6, FILE *time_file);
+                           A2Methods_mapfun *map, bool recursive, int threads,
+                           Pnm_ppm p6, FILE *time_file);
 extern void rotate_90(int col, int row, A2Methods_UArray2 array, void *elem, 
                                                                      void *cl);
 extern void rotate_180(int col, int row, A2Methods_UArray2 array, void *elem, 
                                                                      void *cl);
 extern void rotate_270(int col, int row, A2Methods_UArray2 array, void *elem, 
                                                                      void *cl);
+extern void rotate_90_span(int col, int row, int len, A2Methods_UArray2 array,
+                                                         void *span, void *cl);
+extern void rotate_180_span(int col, int row, int len, A2Methods_UArray2 array,
+                                                         void *span, void *cl);
+extern void rotate_270_span(int col, int row, int len, A2Methods_UArray2 array,
+                                                         void *span, void *cl);
+extern void take_identity(int col, int row, A2Methods_UArray2 array,
+                                                         void *elem, void *cl);
+extern void identity_span(int col, int row, int len, A2Methods_UArray2 array,
+                                                         void *span, void *cl);
 
 /*****************************************************************
  *                  Flip Functions Declarations
  *****************************************************************/
 extern struct Pnm_ppm *flip_driver(char flip, A2Methods_T methods, 
-                           A2Methods_mapfun *map, Pnm_ppm p6, FILE *time_file);
+                           A2Methods_mapfun *map, int threads, Pnm_ppm p6,
+                           FILE *time_file);
 
 extern void flip_horizontal(int col, int row, A2Methods_UArray2 array, 
                                                          void *elem, void *cl);
@@ -42,21 +75,39 @@ extern void flip_horizontal(int col, int row, A2Methods_UArray2 array,
 extern void flip_vertical(int col, int row, A2Methods_UArray2 array, 
                                                          void *elem, void *cl);
 
+extern void flip_horizontal_span(int col, int row, int len, 
+                       A2Methods_UArray2 array, void *span, void *cl);
+
+extern void flip_vertical_span(int col, int row, int len, 
+                       A2Methods_UArray2 array, void *span, void *cl);
+
 /*****************************************************************
  *                  Transpose Function Declarations
  *****************************************************************/
 extern struct Pnm_ppm *transpose_driver(A2Methods_T methods,
-                           A2Methods_mapfun *map, Pnm_ppm p6, FILE *time_file);
+                           A2Methods_mapfun *map, bool recursive, int threads,
+                           Pnm_ppm p6, FILE *time_file);
 
 extern void take_transpose(int col, int row, A2Methods_UArray2 array,
                                                          void *elem, void *cl);
 
+extern void transpose_span(int col, int row, int len, A2Methods_UArray2 array,
+                                                         void *span, void *cl);
+
+extern void take_transverse(int col, int row, A2Methods_UArray2 array,
+                                                         void *elem, void *cl);
+
+extern void transverse_span(int col, int row, int len, A2Methods_UArray2 array,
+                                                         void *span, void *cl);
+
 
 /*****************************************************************
  *                  Helper Function Declarations
  *****************************************************************/
 extern CPUTime_T start_timer();
 
-extern void print_timer(double time, FILE *time_file, int width,
-                       int height);
+extern double wall_clock();
+
+extern void print_timer(double time, double wall_time, FILE *time_file,
+                        int width, int height);
 #endif
\ No newline at end of file
@@ -1,71 +1,110 @@
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
+#include "hilbert.h"
 #include "uarray2.h"
 
 #define T UArray2_T
 
+/* Rows start on a cache-line boundary so that a row never shares a line
+ * with its neighbour and the slab itself is line aligned. */
+#define ROW_ALIGN 64
+
 /* 
- * Element (i, j) in the world of ideas maps to
- * rows[j][i] where the square brackets stand for access
- * to a Hanson UArray_T
+ * Element (i, j) in the world of ideas maps to the 'size' bytes at
+ * elems + j * stride + i * size.  All rows live in one slab; 'stride'
+ * is the row length in bytes rounded up to a multiple of ROW_ALIGN.
  */
 struct T {
         int width, height;
         int size;
-        UArray_T rows; /* UArray_T of 'height' UArray_Ts,
-                          each of length 'width' and size 'size' */
+        long stride;  /* bytes from the start of one row to the next */
+        char *elems;  /* single ROW_ALIGN-aligned slab of height rows */
+        void *slab;   /* what CALLOC returned; elems is slab rounded up */
+        UArray2_releasefun *release; /* for a view: frees what elems is in */
+        void *release_cl;
 };
 
-static inline UArray_T row(T a, int j)
+static inline char *row(T a, int j)
 {
-        UArray_T *prow = UArray_at(a->rows, j);   /* Ramsey idiom */
-        return *prow;
+        return a->elems + j * a->stride;
 }
 
 static int is_ok(T a)
 {
-        return a && UArray_length(a->rows) == a->height &&
-               UArray_size(a->rows) == sizeof(UArray_T) &&
-               (a->height == 0 || (UArray_length(row(a, 0)) == a->width
-                                   && UArray_size  (row(a, 0)) == a->size));
+        return a && a->width >= 0 && a->height >= 0 && a->size > 0 &&
+               a->stride >= (long)a->width * a->size &&
+               (a->stride % ROW_ALIGN == 0 || a->slab == NULL) &&
+               (a->elems != NULL || (long)a->height * a->stride == 0);
 }
 
 T UArray2_new(int width, int height, int size)
 {
-        int i;  /* interates over row number */
         T array;
+        assert(width >= 0 && height >= 0 && size > 0);
         NEW(array);
         array->width  = width;
         array->height = height;
         array->size   = size;
-        array->rows   = UArray_new(height, sizeof(UArray_T));
-        for (i = 0; i < height; i++) {
-                UArray_T *rowp = UArray_at(array->rows, i);
-                *rowp = UArray_new(width, size);
+        array->stride = ((long)width * size + ROW_ALIGN - 1)
+                        / ROW_ALIGN * ROW_ALIGN;
+        array->elems  = NULL;
+        array->slab   = NULL;
+        array->release    = NULL;
+        array->release_cl = NULL;
+        if (height > 0 && array->stride > 0) {
+                /* zeroed like UArray_new; over-allocate to align by hand */
+                array->slab  = CALLOC(1, height * array->stride + ROW_ALIGN);
+                array->elems = (char *)(((uintptr_t)array->slab +
+                                         ROW_ALIGN - 1) &
+                                        ~(uintptr_t)(ROW_ALIGN - 1));
         }
         assert(is_ok(array));
         return array;
 }
 
+/*
+ * A view is a UArray2 over memory it does not own, such as a P6 raster
+ * mapped from a file: rows are 'stride' bytes apart with no alignment
+ * promised. Freeing the view calls release(cl), if given, in place of
+ * freeing the memory.
+ */
+T UArray2_view(int width, int height, int size, long stride, void *elems,
+               UArray2_releasefun release, void *cl)
+{
+        T array;
+        assert(width >= 0 && height >= 0 && size > 0);
+        assert(stride >= (long)width * size);
+        NEW(array);
+        array->width  = width;
+        array->height = height;
+        array->size   = size;
+        array->stride = stride;
+        array->elems  = elems;
+        array->slab   = NULL;
+        array->release    = release;
+        array->release_cl = cl;
+        assert(is_ok(array));
+        return array;
+}
+
 void UArray2_free(T *array2)
 {
-        int i;
         assert(array2 != NULL && *array2 != NULL);
-        for (i = 0; i < (*array2)->height; i++) {
-                UArray_T p = row(*array2, i);
-                UArray_free(&p);
-        }
-        UArray_free(&(*array2)->rows);
+        if ((*array2)->release != NULL)
+                (*array2)->release((*array2)->release_cl);
+        FREE((*array2)->slab);
         FREE(*array2);
 }
 
 void *UArray2_at(T array2, int i, int j)
 {
         assert(array2 != NULL);
-        return UArray_at(row(array2, j), i);
+        assert(i >= 0 && i < array2->width);
+        assert(j >= 0 && j < array2->height);
+        return row(array2, j) + i * array2->size;
 }
 
 int UArray2_height(T array2)
@@ -94,11 +133,12 @@ void UArray2_map_row_major(T array2,
         assert(array2!= NULL);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
+        int size = array2->size;
         for (int j = 0; j < h; j++) {
-                /* don't want row/UArray_at in inner loop */
-                UArray_T thisrow = row(array2, j); 
-                for (int i = 0; i < w; i++)
-                        apply(i, j, array2, UArray_at(thisrow, i), cl);
+                /* walk the row with a pointer; no per-cell index math */
+                char *p = row(array2, j); 
+                for (int i = 0; i < w; i++, p += size)
+                        apply(i, j, array2, p, cl);
         }
 }
 
@@ -110,7 +150,47 @@ void UArray2_map_col_major(T array2,
         assert(array2 != NULL);
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
-        for (int i = 0; i < w; i++)
-                for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
-}
\ No newline at end of file
+        long stride = array2->stride;
+        for (int i = 0; i < w; i++) {
+                char *p = array2->elems + (long)i * array2->size;
+                for (int j = 0; j < h; j++, p += stride)
+                        apply(i, j, array2, p, cl);
+        }
+}
+
+/* each row is contiguous, so it is passed as a single span */
+void UArray2_map_spans(T array2, 
+                       void apply(int i, int j, int len, T array2,
+                                  void *span, void *cl), 
+                       void *cl)
+{
+        assert(array2 != NULL);
+        int h = array2->height;
+        int w = array2->width;
+        for (int j = 0; j < h; j++)
+                apply(0, j, w, array2, row(array2, j), cl);
+}
+
+/* what visit_cell needs to turn a grid point into an apply call */
+struct hilbert_cl {
+        T array2;
+        UArray2_applyfun *apply;
+        void *cl;
+};
+
+static void visit_cell(int i, int j, void *vcl)
+{
+        struct hilbert_cl *hcl = vcl;
+        T a = hcl->array2;
+        hcl->apply(i, j, a, row(a, j) + i * a->size, hcl->cl);
+}
+
+void UArray2_map_hilbert(T array2, 
+                         void apply(int i, int j, T array2, 
+                                    void *elem, void *cl), 
+                         void *cl)
+{
+        assert(array2 != NULL);
+        struct hilbert_cl hcl = { array2, apply, cl };
+        Hilbert_map(array2->width, array2->height, visit_cell, &hcl);
+}
@@ -6,8 +6,15 @@ typedef struct T *T;
 
 typedef void UArray2_applyfun(int i, int j, T array2, void *elem, void *cl);
 typedef void UArray2_mapfun(T array2, UArray2_applyfun apply, void *cl);
+typedef void UArray2_spanfun(int i, int j, int len, T array2, void *span,
+                             void *cl);
+
+typedef void UArray2_releasefun(void *cl);
 
 extern T     UArray2_new   (int width, int height, int size);
+extern T     UArray2_view  (int width, int height, int size, long stride,
+                            void *elems, UArray2_releasefun release,
+                            void *cl);
 extern void  UArray2_free  (T *array2);
 extern int   UArray2_width (T array2);
 extern int   UArray2_height(T array2);
@@ -15,6 +22,8 @@ extern int   UArray2_size  (T array2);
 extern void *UArray2_at    (T array2, int i, int j);
 extern void  UArray2_map_row_major(T array2, UArray2_applyfun apply, void *cl);
 extern void  UArray2_map_col_major(T array2, UArray2_applyfun apply, void *cl);
+extern void  UArray2_map_hilbert  (T array2, UArray2_applyfun apply, void *cl);
+extern void  UArray2_map_spans    (T array2, UArray2_spanfun apply, void *cl);
 
 #undef T
 #endif
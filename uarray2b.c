@@ -13,29 +13,39 @@
  *              array. This file include functions such as UArray2b_new, 
  *              UArray2b_new_64K_block, UArray2b_free, UArray2b_width,
  *              UArray2b_height, UArray2b_size, UArray2b_blocksize,
- *              UArray2b_at, and UArray2b_map. 
+ *              UArray2b_at, UArray2b_block, UArray2b_map, UArray2b_map_hilbert,
+ *              UArray2b_map_spans, UArray2b_default_blocksize and
+ *              UArray2b_set_default_blocksize.
  *              
  **************************************************************/
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
-#include <math.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
-#include "uarray2.h"
+#include "hilbert.h"
 #include "uarray2b.h"
 
 #define T UArray2b_T
 
+/* the block buffer starts on a cache-line boundary */
+#define BLOCK_ALIGN 64
+
 /********** T ********
  * 
  * Struct for the blocked 2D bitmap array.
  * Contains the width and height for the 2D UArray.
  * Size is used for the size of each individual cell.
- * Blocks is the UArray2 that will hold all the UArray2s for the 2D array.
+ * Every block is stored back-to-back in one buffer: block (bc, br) starts
+ * at blocks + (br * block_width + bc) * block_bytes, and within a block
+ * cells are laid out row by row. When the blocksize is a power of two,
+ * log2_blocksize holds its exponent so that UArray2b_at can split an index
+ * into block and offset with a shift and a mask instead of a divide.
  *
  *******************/
 struct T {
@@ -44,8 +54,10 @@ struct T {
         int blocksize; /* dimensions of each block in the array */
         int block_width; /* number of blocks in the width */
         int block_height; /* number of blocks in the height */
-        UArray2_T blocks; /* 2D array of blocks that comprise the entire array,
-                             with each block being a UArray itself */
+        int log2_blocksize; /* log2(blocksize), or -1 if not a power of 2 */
+        long block_bytes; /* bytes in one block: blocksize^2 * size */
+        char *blocks; /* all blocks, back-to-back, in row-major block order */
+        void *slab; /* memory returned by CALLOC; blocks is slab aligned */
 };
 
 /****************** UArray2b_new *******************
@@ -98,31 +110,223 @@ T UArray2b_new(int width, int height, int size, int blocksize)
                 array->block_height++;
         }
 
-        /* create the 2D array of blocks */
-        array->blocks = UArray2_new(array->block_width, array->block_height, 
-                                                             sizeof(UArray_T));
-
-        /* create the 2D array of blocks */
-        for (int i = 0; i < array->block_width; i++) {
-                for (int j = 0; j < array->block_height; j++) {
-                        UArray_T *blockp = UArray2_at(array->blocks, i, j);
-                        *blockp = UArray_new(blocksize * blocksize, size);
+        /* remember the exponent of power-of-two blocksizes */
+        array->log2_blocksize = -1;
+        if ((blocksize & (blocksize - 1)) == 0) {
+                array->log2_blocksize = 0;
+                while ((1 << array->log2_blocksize) < blocksize) {
+                        array->log2_blocksize++;
                 }
         }
 
+        /* allocate every block in a single zeroed, line-aligned buffer */
+        array->block_bytes = (long)blocksize * blocksize * size;
+        array->slab = CALLOC(1, (long)array->block_width * 
+                             array->block_height * array->block_bytes + 
+                             BLOCK_ALIGN);
+        array->blocks = (char *)(((uintptr_t)array->slab + BLOCK_ALIGN - 1) &
+                                 ~(uintptr_t)(BLOCK_ALIGN - 1));
+
         /* Check that the array was created of correct dimensions and size */
-        assert(array && (UArray2_width(array->blocks) == 
-                (array->block_width)) && (UArray2_height(array->blocks) == 
-                (array->block_height)) && (UArray2_size(array->blocks) == 
-                sizeof(UArray2_T)));
+        assert(array && (long)array->block_width * blocksize >= width &&
+               (long)array->block_height * blocksize >= height &&
+               array->blocks != NULL);
         return array;
 }
 
+/* cache geometry assumed when sysfs cannot be read */
+#define DEFAULT_L1_BYTES   (32 * 1024)
+#define DEFAULT_L2_BYTES   (256 * 1024)
+#define DEFAULT_LINE_BYTES 64
+
+/********** cache_info ********
+ * 
+ * Sizes, in bytes, of the data caches seen by cpu0 and of its cache lines.
+ * Filled in once, the first time a default blocksize is needed, even when
+ * several threads make arrays at once (batch mode does).
+ *
+ *******************/
+static struct cache_info {
+        long l1_bytes, l2_bytes, line_bytes;
+} cache = { 0, 0, 0 };
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+/* blocksize forced by UArray2b_set_default_blocksize, 0 if none */
+static int blocksize_override = 0;
+
+/************* read_sysfs_value ***************
+ * 
+ * Reads the first line of a sysfs cache attribute into buf.
+ *
+ * Parameters:
+ *      int index:        which cpu0 cache index directory to read from
+ *      const char *attr: name of the attribute file (e.g. "size")
+ *      char *buf:        buffer to hold the value
+ *      int len:          length of buf
+ * Returns:
+ *      true if the attribute was read, false otherwise
+ * Expects:
+ *      None
+ *
+ ********************************************/
+static bool read_sysfs_value(int index, const char *attr, char *buf, int len)
+{
+        char path[128];
+        snprintf(path, sizeof(path),
+                 "/sys/devices/system/cpu/cpu0/cache/index%d/%s", index, attr);
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL) {
+                return false;
+        }
+        bool ok = fgets(buf, len, fp) != NULL;
+        fclose(fp);
+        return ok;
+}
+
+/************* load_cache_info ***************
+ * 
+ * Fills in the cache struct from sysfs, using the DEFAULT_ geometry for any
+ * level that the kernel does not report. The L1 size is that of the data (or
+ * unified) cache; instruction caches are ignored.
+ *
+ * Parameters:
+ *      None
+ * Returns:
+ *      None
+ * Expects:
+ *      None
+ *
+ ********************************************/
+static void load_cache_info(void)
+{
+        char buf[64];
+        cache.l1_bytes = DEFAULT_L1_BYTES;
+        cache.l2_bytes = DEFAULT_L2_BYTES;
+        cache.line_bytes = DEFAULT_LINE_BYTES;
+
+        for (int index = 0; read_sysfs_value(index, "level", buf,
+                                             sizeof(buf)); index++) {
+                int level = atoi(buf);
+                if (!read_sysfs_value(index, "type", buf, sizeof(buf)) ||
+                    strncmp(buf, "Instruction", 11) == 0) {
+                        continue;
+                }
+                if (!read_sysfs_value(index, "size", buf, sizeof(buf))) {
+                        continue;
+                }
+                /* sizes are reported as e.g. "48K" or "2048K" or "4M" */
+                char *unit;
+                long bytes = strtol(buf, &unit, 10);
+                if (*unit == 'K') {
+                        bytes *= 1024;
+                } else if (*unit == 'M') {
+                        bytes *= 1024 * 1024;
+                }
+                if (bytes <= 0) {
+                        continue;
+                }
+                if (level == 1) {
+                        cache.l1_bytes = bytes;
+                        if (read_sysfs_value(index, "coherency_line_size",
+                                             buf, sizeof(buf)) &&
+                            atoi(buf) > 0) {
+                                cache.line_bytes = atoi(buf);
+                        }
+                } else if (level == 2) {
+                        cache.l2_bytes = bytes;
+                }
+        }
+}
+
+/************* blocksize_for ***************
+ * 
+ * Returns the largest power-of-two blocksize for which one source and one
+ * destination block of cells of the given size fit together in a cache of
+ * the given number of bytes.
+ *
+ * Parameters:
+ *      long cache_bytes: capacity of the cache level being targeted
+ *      int size:         size of each cell in bytes
+ * Returns:
+ *      the chosen blocksize, at least 1
+ * Expects:
+ *      size > 0
+ *
+ ********************************************/
+static int blocksize_for(long cache_bytes, int size)
+{
+        int blocksize = 1;
+        while (2L * (2 * blocksize) * (2 * blocksize) * size <= cache_bytes) {
+                blocksize *= 2;
+        }
+        return blocksize;
+}
+
+/************* UArray2b_default_blocksize ***************
+ * 
+ * Returns the blocksize that UArray2b_new_64K_block uses for cells of the
+ * given size. An override from UArray2b_set_default_blocksize wins, then the
+ * UARRAY2B_BLOCKSIZE environment variable, and otherwise the blocksize is
+ * sized to the L1 data cache. If that would make a block row narrower than
+ * a cache line (very large cells), the blocksize is sized to L2 instead.
+ *
+ * Parameters:
+ *      int size: the size of each cell in bytes
+ * Returns:
+ *      the default blocksize, at least 1
+ * Expects:
+ *      size > 0 (throws a CRE otherwise)
+ *      UARRAY2B_BLOCKSIZE, if set, is a positive integer (CRE otherwise)
+ *
+ ********************************************/
+int UArray2b_default_blocksize(int size)
+{
+        assert(size > 0);
+        if (blocksize_override > 0) {
+                return blocksize_override;
+        }
+
+        const char *env = getenv("UARRAY2B_BLOCKSIZE");
+        if (env != NULL && *env != '\0') {
+                char *end;
+                long blocksize = strtol(env, &end, 10);
+                assert(*end == '\0' && blocksize > 0 && blocksize <= 65536);
+                return blocksize;
+        }
+
+        pthread_once(&cache_once, load_cache_info);
+        int blocksize = blocksize_for(cache.l1_bytes, size);
+        if ((long)blocksize * size < cache.line_bytes) {
+                blocksize = blocksize_for(cache.l2_bytes, size);
+        }
+        return blocksize;
+}
+
+/************* UArray2b_set_default_blocksize ***************
+ * 
+ * Forces the blocksize used by UArray2b_new_64K_block, e.g. from a
+ * command-line option. Passing 0 restores automatic selection.
+ *
+ * Parameters:
+ *      int blocksize: the blocksize to use, or 0
+ * Returns:
+ *      None
+ * Expects:
+ *      blocksize >= 0 (throws a CRE otherwise)
+ *
+ ********************************************/
+void UArray2b_set_default_blocksize(int blocksize)
+{
+        assert(blocksize >= 0);
+        blocksize_override = blocksize;
+}
+
 /************* UArray2b_new_64K_block ***************
  * 
  * Creates a new instance of a UArray2b given its width, height, and size.
- * This function defaults the blocksize to be as large as possible while
- * still allowing a block to fit in 64KB of RAM.
+ * Despite its historic name, the blocksize comes from
+ * UArray2b_default_blocksize, which fits blocks to this machine's caches
+ * rather than to a fixed 64KB.
  *
  * Parameters:
  *      int width:     the width (number of cells along the x-axis) of the
@@ -141,16 +345,8 @@ T UArray2b_new_64K_block(int width, int height, int size)
 {
         /* check for valid (positive) parameters */
         assert(width >  0 && height > 0 && size > 0);
-
-        /* the number of bytes in 64KB divided by the size of each cell */
-        int blocksize = (64 * 1024) / (size * 1024);
-
-        if (blocksize < 4) {
-                blocksize = 1;
-        } else {
-                blocksize = sqrt(blocksize);
-        }
-        return UArray2b_new(width, height, size, blocksize);
+        return UArray2b_new(width, height, size,
+                            UArray2b_default_blocksize(size));
 }
 
 /************* UArray2b_free ***************
@@ -170,13 +366,7 @@ T UArray2b_new_64K_block(int width, int height, int size)
 void UArray2b_free(T *array2b)
 {
         assert(array2b != NULL && *array2b != NULL);
-        UArray2_T p = (*array2b)->blocks;
-        for (int i = 0; i < (*array2b)->block_width; i++) {
-                for (int j = 0; j < (*array2b)->block_height; j++) {
-                        UArray_free(UArray2_at(p, i, j));
-                }
-        }
-        UArray2_free(&p);
+        FREE((*array2b)->slab);
         FREE(*array2b);
 }
 
@@ -275,128 +465,133 @@ int UArray2b_blocksize(T array2b)
 void *UArray2b_at(T array2b, int column, int row)
 {
         assert(array2b != NULL);
-        assert((column >= 0) && (column < UArray2b_width(array2b)));
-        assert((row >= 0) && (row < UArray2b_height(array2b)));
-        int blocksize = UArray2b_blocksize(array2b);
-        int block_col = column / blocksize;
-        int block_row = row / blocksize;
-        
-        UArray_T block = *(UArray_T *)UArray2_at(array2b->blocks, 
-                          block_col, block_row);
-        
-        return UArray_at(block,
-                         blocksize * (row % blocksize) + (column % blocksize));
+        assert((column >= 0) && (column < array2b->width));
+        assert((row >= 0) && (row < array2b->height));
+        int shift = array2b->log2_blocksize;
+        int block_col, block_row, cell;
+
+        if (shift >= 0) {
+                /* power-of-two blocksize: shifts and masks only */
+                int mask = array2b->blocksize - 1;
+                block_col = column >> shift;
+                block_row = row >> shift;
+                cell = ((row & mask) << shift) | (column & mask);
+        } else {
+                int blocksize = array2b->blocksize;
+                block_col = column / blocksize;
+                block_row = row / blocksize;
+                cell = blocksize * (row - block_row * blocksize) + 
+                       (column - block_col * blocksize);
+        }
+
+        return array2b->blocks + 
+               ((long)block_row * array2b->block_width + block_col) * 
+               array2b->block_bytes + (long)cell * array2b->size;
 }
 
-/************* corner_check ***************
+/************* UArray2b_block ***************
  * 
- * Returns whether the element at the indices of the given UArray2b is part
- * of the array (it exists). We know this element is in the bottom right
- * corner block, so we must verify that it is actually part of the used array.
+ * Returns a pointer to the first cell of the block in the given block
+ * column and block row. Kernels that work a whole block at a time use it to
+ * address cells directly: cell (c, r) of the block is at offset
+ * (r * blocksize + c) * size from this pointer.
  *
  * Parameters:
- *      int c: integer representing the index of the column of the current
- *             element
- *      int r: integer representing the index of the row of the current
- *             element
- *      T array2b: a UArray2b of which we are checking the corner
+ *      T array2b:     a UArray2b
+ *      int block_col: column index of the block, in blocks
+ *      int block_row: row index of the block, in blocks
  * Returns:
- *      boolean deciding whether the element at the given indices is valid to
- *      execute the apply function on
+ *      a void pointer to the first cell of the block
  * Expects:
- *      None
+ *      The passed-in UArray2b is not NULL (throw CRE if NULL)
+ *      The block indices are within the grid of blocks (throw CRE if not)
  *
  ********************************************/
-bool corner_check(int c, int r, T array2b)
+void *UArray2b_block(T array2b, int block_col, int block_row)
 {
-        /* check if we are at the bottom right of 2D array */
-        if (r / array2b->blocksize == array2b->block_height - 1 &&
-                c / array2b->blocksize == array2b->block_width - 1) {
-                /* check if the element at the indices exists
-                and then call apply func if so */
-                if ((array2b->height % array2b->blocksize == 0 &&
-                     array2b->width % array2b->blocksize == 0) ||
-                    (array2b->height % array2b->blocksize >= (r + 1) %
-                                                array2b->blocksize ||
-                     array2b->width % array2b->blocksize >= (c + 1) %
-                                                array2b->blocksize)) {
-                        return true;
-                }
-        }
-        return false;
+        assert(array2b != NULL);
+        assert(block_col >= 0 && block_col < array2b->block_width);
+        assert(block_row >= 0 && block_row < array2b->block_height);
+        return array2b->blocks + 
+               ((long)block_row * array2b->block_width + block_col) * 
+               array2b->block_bytes;
 }
 
-/************* right_edge_check ***************
+/************* map_full_block ***************
  * 
- * Returns whether the element at the indices of the given UArray2b is part
- * of the array (it exists). We know this element is in a block on the right
- * edge, so we must verify that it is actually part of the used array.
+ * Executes the apply function on every cell of an interior block, one that
+ * lies entirely inside the array. Cells are visited in memory order, so the
+ * loop is a single pointer walk with no bounds or edge checks.
  *
  * Parameters:
- *      int c: integer representing the index of the column of the current
- *             element
- *      int r: integer representing the index of the row of the current
- *             element
- *      T array2b: a UArray2b of which we are checking the right edge
+ *      T array2b:  the UArray2b being mapped through
+ *      char *block: pointer to the first cell of the block
+ *      int col0:   column index of the block's top-left cell
+ *      int row0:   row index of the block's top-left cell
+ *      void apply: the apply function to execute on each cell
+ *      void *cl:   closure passed through to apply
  * Returns:
- *      boolean deciding whether the element at the given indices is valid to
- *      execute the apply function on
- * Expects:
  *      None
+ * Expects:
+ *      The block is not clipped by the right or bottom edge of the array
  *
  ********************************************/
-bool right_edge_check(int r, T array2b)
+static inline void map_full_block(T array2b, char *block, int col0, int row0,
+                                  void apply(int col, int row, T array2b,
+                                             void *elem, void *cl), void *cl)
 {
-        if (r / array2b->blocksize == array2b->block_height - 1) {
-                /* check if the element at the indices exists
-                and then call apply func if so */
-                if ((array2b->height % array2b->blocksize == 0) ||
-                     array2b->height % array2b->blocksize >= (r + 1) %
-                     array2b->blocksize) {
-                        return true;
+        int bs = array2b->blocksize;
+        int size = array2b->size;
+        for (int r = row0; r < row0 + bs; r++) {
+                for (int c = col0; c < col0 + bs; c++, block += size) {
+                        apply(c, r, array2b, block, cl);
                 }
         }
-        return false;
 }
 
-/************* bottom_edge_check ***************
+/************* map_clipped_block ***************
  * 
- * Returns whether the element at the indices of the given UArray2b is part
- * of the array (it exists). We know this element is in a block on the bottom
- * edge, so we must verify that it is actually part of the used array.
+ * Executes the apply function on the used cells of a block on the right or
+ * bottom edge of the array. Only the top-left cols x rows corner of such a
+ * block holds cells of the array; the rest is padding that is skipped.
  *
  * Parameters:
- *      int c: integer representing the index of the column of the current
- *             element
- *      int r: integer representing the index of the row of the current
- *             element
- *      T array2b: a UArray2b of which we are checking the bottom edge
+ *      T array2b:  the UArray2b being mapped through
+ *      char *block: pointer to the first cell of the block
+ *      int col0:   column index of the block's top-left cell
+ *      int row0:   row index of the block's top-left cell
+ *      int cols:   number of used columns in the block
+ *      int rows:   number of used rows in the block
+ *      void apply: the apply function to execute on each cell
+ *      void *cl:   closure passed through to apply
  * Returns:
- *      boolean deciding whether the element at the given indices is valid to
- *      execute the apply function on
- * Expects:
  *      None
+ * Expects:
+ *      0 < cols <= blocksize and 0 < rows <= blocksize
  *
  ********************************************/
-bool bottom_edge_check(int c, T array2b)
+static void map_clipped_block(T array2b, char *block, int col0, int row0,
+                              int cols, int rows,
+                              void apply(int col, int row, T array2b,
+                                         void *elem, void *cl), void *cl)
 {
-        if (c / array2b->blocksize == array2b->block_width - 1) {
-                /* check if the element at the indices exists
-                and then call apply func if so */
-                if ((array2b->width % array2b->blocksize == 0) ||
-                        array2b->width % array2b->blocksize >= (c + 1) %
-                        array2b->blocksize) {
-                        return true;
+        long row_bytes = (long)array2b->blocksize * array2b->size;
+        int size = array2b->size;
+        for (int r = 0; r < rows; r++, block += row_bytes) {
+                char *p = block;
+                for (int c = 0; c < cols; c++, p += size) {
+                        apply(col0 + c, row0 + r, array2b, p, cl);
                 }
         }
-        return false;
 }
 
 /************* UArray2b_map ***************
  * 
  * Mapping function which parses through the given array2b in block-major
  * order, executing the apply function on each element, and storing the closure
- * throughout the iterations.
+ * throughout the iterations. Every cell of a block is visited before moving on
+ * to the next block, so the traversal walks memory sequentially. Only the
+ * blocks on the right and bottom edges need to be clipped to the array.
  *
  * Parameters:
  *      T array2b:  a UArray2b that is being mapped through
@@ -413,27 +608,140 @@ bool bottom_edge_check(int c, T array2b)
 void UArray2b_map(T array2b, void apply(int col, int row, T array2b,void *elem,
                                                           void *cl),void *cl) {
         assert(array2b != NULL);
+        int bs = array2b->blocksize;
         int h = array2b->height;  /* keeping height and width in registers */
         int w = array2b->width;   /* avoids extra memory traffic */
-        /* parse through height and then width of 2D array <- (row-major) */
-        for (int r = 0; r < h; r++) {
-                for (int c = 0; c < w; c++) {
-                        if (corner_check(c, r, array2b)) {
-                                apply(c, r, array2b, 
-                                               UArray2b_at(array2b, c, r), cl);
-                        /* check if we are at a bottom edge of 2D array */
-                        } else if (right_edge_check(r, array2b)) {
-                                apply(c, r, array2b, 
-                                               UArray2b_at(array2b, c, r), cl);
-                        /* check if we are at a right edge of 2D array */
-                        } else if (bottom_edge_check(c, array2b)) {
-                                apply(c, r, array2b,
-                                               UArray2b_at(array2b, c, r), cl);
-                        /* else we're not at an edge and don't have to worry */
+        char *block = array2b->blocks;
+
+        /* blocks are stored in the order we visit them */
+        for (int row0 = 0; row0 < h; row0 += bs) {
+                int rows = (h - row0 < bs) ? h - row0 : bs;
+                for (int col0 = 0; col0 < w; col0 += bs) {
+                        int cols = (w - col0 < bs) ? w - col0 : bs;
+                        if (rows == bs && cols == bs) {
+                                map_full_block(array2b, block, col0, row0,
+                                               apply, cl);
                         } else {
-                                apply(c, r, array2b, 
-                                               UArray2b_at(array2b, c, r), cl);
+                                map_clipped_block(array2b, block, col0, row0,
+                                                  cols, rows, apply, cl);
                         }
+                        block += array2b->block_bytes;
                 }
         }
 }
+
+/************* UArray2b_map_spans ***************
+ * 
+ * Mapping function which visits the blocks of the given array2b in the same
+ * order as UArray2b_map, but calls apply once per row of each block. The
+ * row is passed as a pointer to its first cell plus the number of cells in
+ * it, so callers can process a whole block row per call. Rows of edge
+ * blocks are clipped to the array.
+ *
+ * Parameters:
+ *      T array2b:  a UArray2b that is being mapped through
+ *      void apply: the function executed on every block row
+ *      void *cl:   closure passed through to apply
+ * Returns:
+ *      None
+ * Expects:
+ *      The passed-in UArray2b is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+void UArray2b_map_spans(T array2b, void apply(int col, int row, int len,
+                                              T array2b, void *span,
+                                              void *cl), void *cl)
+{
+        assert(array2b != NULL);
+        int bs = array2b->blocksize;
+        int h = array2b->height;
+        int w = array2b->width;
+        long row_bytes = (long)bs * array2b->size;
+        char *block = array2b->blocks;
+
+        for (int row0 = 0; row0 < h; row0 += bs) {
+                int rows = (h - row0 < bs) ? h - row0 : bs;
+                for (int col0 = 0; col0 < w; col0 += bs) {
+                        int cols = (w - col0 < bs) ? w - col0 : bs;
+                        char *p = block;
+                        for (int r = 0; r < rows; r++, p += row_bytes) {
+                                apply(col0, row0 + r, cols, array2b, p, cl);
+                        }
+                        block += array2b->block_bytes;
+                }
+        }
+}
+
+/********** hilbert_closure ********
+ * 
+ * Closure for visit_block: the array being mapped and the caller's apply
+ * function and closure.
+ *
+ *******************/
+struct hilbert_closure {
+        T array2b;
+        void (*apply)(int col, int row, T array2b, void *elem, void *cl);
+        void *cl;
+};
+
+/************* visit_block ***************
+ * 
+ * Hilbert_map visit function that maps every cell of the block in block
+ * column bc and block row br, clipping it if it lies on an edge.
+ *
+ * Parameters:
+ *      int bc:    block column index
+ *      int br:    block row index
+ *      void *vcl: pointer to a struct hilbert_closure
+ * Returns:
+ *      None
+ * Expects:
+ *      0 <= bc < block_width and 0 <= br < block_height
+ *
+ ********************************************/
+static void visit_block(int bc, int br, void *vcl)
+{
+        struct hilbert_closure *hcl = vcl;
+        T a = hcl->array2b;
+        int bs = a->blocksize;
+        int col0 = bc * bs;
+        int row0 = br * bs;
+        int cols = (a->width - col0 < bs) ? a->width - col0 : bs;
+        int rows = (a->height - row0 < bs) ? a->height - row0 : bs;
+        char *block = a->blocks + 
+                      ((long)br * a->block_width + bc) * a->block_bytes;
+
+        if (rows == bs && cols == bs) {
+                map_full_block(a, block, col0, row0, hcl->apply, hcl->cl);
+        } else {
+                map_clipped_block(a, block, col0, row0, cols, rows,
+                                  hcl->apply, hcl->cl);
+        }
+}
+
+/************* UArray2b_map_hilbert ***************
+ * 
+ * Mapping function which visits the blocks of the given array2b along a
+ * Hilbert curve over the grid of blocks. Each block is mapped completely,
+ * row by row, before moving on. Successive blocks are always neighbours, so
+ * a transformation's writes into a rotated destination stay local too.
+ *
+ * Parameters:
+ *      T array2b:  a UArray2b that is being mapped through
+ *      void apply: the apply function executed on every element
+ *      void *cl:   closure passed through to apply
+ * Returns:
+ *      None
+ * Expects:
+ *      The passed-in UArray2b is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+void UArray2b_map_hilbert(T array2b, void apply(int col, int row, T array2b,
+                                                void *elem, void *cl),
+                          void *cl)
+{
+        assert(array2b != NULL);
+        struct hilbert_closure hcl = { array2b, apply, cl };
+        Hilbert_map(array2b->block_width, array2b->block_height,
+                    visit_block, &hcl);
+}
@@ -0,0 +1,49 @@
+#ifndef UARRAY2B_INCLUDED
+#define UARRAY2B_INCLUDED
+
+#define T UArray2b_T
+typedef struct T *T;
+
+extern T    UArray2b_new (int width, int height, int size, int blocksize);
+  /* new blocked 2d array: blocksize = square root of # of cells in block */
+extern T    UArray2b_new_64K_block(int width, int height, int size);
+  /* new blocked 2d array: blocksize chosen so that a source and a
+     destination block fit in the L1 data cache (L2 if L1 is too small);
+     see UArray2b_default_blocksize */
+extern void  UArray2b_free     (T *array2b);
+extern int   UArray2b_width    (T array2b);
+extern int   UArray2b_height   (T array2b);
+extern int   UArray2b_size     (T array2b);
+extern int   UArray2b_blocksize(T array2b);
+extern void *UArray2b_at(T array2b, int column, int row);
+  /* return a pointer to the cell in the given column and row.
+     index out of range is a checked run-time error */
+extern void *UArray2b_block(T array2b, int block_col, int block_row);
+  /* return a pointer to the first cell of the given block. A block holds
+     blocksize rows of blocksize cells, stored row by row; the cells of an
+     edge block that fall outside the array are padding */
+extern void  UArray2b_map(T array2b, 
+    void apply(int col, int row, T array2b, void *elem, void *cl), void *cl);
+  /* visits every cell in one block before moving to another block */
+extern void  UArray2b_map_hilbert(T array2b, 
+    void apply(int col, int row, T array2b, void *elem, void *cl), void *cl);
+  /* like UArray2b_map, but the blocks are taken in Hilbert-curve order */
+extern void  UArray2b_map_spans(T array2b,
+    void apply(int col, int row, int len, T array2b, void *span, void *cl),
+    void *cl);
+  /* same order as UArray2b_map, but passes each (clipped) row of a block
+     as one span of len contiguous cells starting at (col, row) */
+
+extern int   UArray2b_default_blocksize(int size);
+  /* blocksize used by UArray2b_new_64K_block for cells of the given size:
+     the value set by UArray2b_set_default_blocksize if any, else the
+     UARRAY2B_BLOCKSIZE environment variable if set, else derived from
+     the cache sizes in /sys/devices/system/cpu/cpu0/cache */
+extern void  UArray2b_set_default_blocksize(int blocksize);
+  /* override the default blocksize; 0 restores automatic selection */
+
+/* it is a checked run-time error to pass a NULL T
+   to any function in this interface */
+
+#undef T
+#endif
@@ -0,0 +1,408 @@
+/**************************************************************
+ *
+ *                     uarray2m.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements the UArray2m_T interface, a 2D array
+ *              whose cells are stored along a Morton (Z-order) curve. Cells
+ *              that are close in both column and row are close in memory at
+ *              every scale, so the layout needs no tuned blocksize, though
+ *              without span kernels it is slower in practice than a plain
+ *              or blocked array (see the README). This file
+ *              includes the functions UArray2m_new, UArray2m_free,
+ *              UArray2m_width, UArray2m_height, UArray2m_size, UArray2m_at,
+ *              UArray2m_map and UArray2m_map_hilbert.
+ *              
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "hilbert.h"
+#include "uarray2m.h"
+
+#define T UArray2m_T
+
+/* the cell buffer starts on a cache-line boundary */
+#define CELL_ALIGN 64
+
+/********** T ********
+ * 
+ * Struct for the Morton-ordered 2D array.
+ * Each dimension is padded up to a power of two. The low 'low_bits' bits of
+ * the column and row are interleaved (column bits in the even positions) to
+ * form the low 2 * low_bits bits of a cell's index. Whichever dimension is
+ * longer has bits left over, and those become the high bits of the index.
+ * A non-square array is therefore a row or column of Z-ordered squares.
+ *
+ *******************/
+struct T {
+        int width, height; /* width and height of the array */
+        int size; /* size of each cell */
+        int low_bits; /* log2 of the smaller padded dimension */
+        int wide; /* 1 if the padded width exceeds the padded height */
+        long cells; /* number of cells including padding */
+        char *elems; /* cells in Morton order */
+        void *slab; /* memory returned by CALLOC; elems is slab aligned */
+};
+
+/************* spread_bits ***************
+ * 
+ * Moves bit k of x to bit 2k of the result, leaving the odd bits zero.
+ *
+ * Parameters:
+ *      uint32_t x: value whose bits are spread
+ * Returns:
+ *      x with a zero inserted above each of its bits
+ * Expects:
+ *      None
+ *
+ ********************************************/
+static inline uint64_t spread_bits(uint32_t x)
+{
+        uint64_t v = x;
+        v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+        v = (v | (v << 8))  & 0x00FF00FF00FF00FFULL;
+        v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v << 2))  & 0x3333333333333333ULL;
+        v = (v | (v << 1))  & 0x5555555555555555ULL;
+        return v;
+}
+
+/************* compact_bits ***************
+ * 
+ * Inverse of spread_bits: gathers the even bits of v into the low half.
+ *
+ * Parameters:
+ *      uint64_t v: value whose even bits are gathered
+ * Returns:
+ *      bit 2k of v as bit k of the result
+ * Expects:
+ *      None
+ *
+ ********************************************/
+static inline uint32_t compact_bits(uint64_t v)
+{
+        v &= 0x5555555555555555ULL;
+        v = (v | (v >> 1))  & 0x3333333333333333ULL;
+        v = (v | (v >> 2))  & 0x0F0F0F0F0F0F0F0FULL;
+        v = (v | (v >> 4))  & 0x00FF00FF00FF00FFULL;
+        v = (v | (v >> 8))  & 0x0000FFFF0000FFFFULL;
+        v = (v | (v >> 16)) & 0x00000000FFFFFFFFULL;
+        return (uint32_t)v;
+}
+
+/************* log2_ceil ***************
+ * 
+ * Returns the smallest k such that 2^k >= n.
+ *
+ * Parameters:
+ *      int n: the dimension being padded
+ * Returns:
+ *      log2 of n rounded up
+ * Expects:
+ *      n > 0
+ *
+ ********************************************/
+static int log2_ceil(int n)
+{
+        int k = 0;
+        while ((1L << k) < n) {
+                k++;
+        }
+        return k;
+}
+
+/****************** UArray2m_new *******************
+ * 
+ * Creates a new instance of a UArray2m given its width, height and size.
+ *
+ * Parameters:
+ *      int width:  the width (number of cells along the x-axis) of the
+ *                  UArray2m to be initialized
+ *      int height: the height (number of cells along the y-axis) of the
+ *                  UArray2m to be initialized
+ *      int size:   the size of each cell for the new UArray2m
+ * Returns:
+ *      Returns the struct holding the contents of the new UArray2m.
+ * Expects:
+ *      the passed-in width > 0, height > 0, size > 0 (throws a CRE
+ *      otherwise)
+ *
+ ********************************************/
+T UArray2m_new(int width, int height, int size)
+{
+        assert(width > 0 && height > 0 && size > 0);
+        T array;
+        NEW(array);
+        array->width = width;
+        array->height = height;
+        array->size = size;
+
+        int width_bits = log2_ceil(width);
+        int height_bits = log2_ceil(height);
+        array->wide = width_bits > height_bits;
+        array->low_bits = array->wide ? height_bits : width_bits;
+        array->cells = 1L << (width_bits + height_bits);
+
+        /* zeroed like UArray_new; over-allocate to align by hand */
+        array->slab = CALLOC(1, array->cells * size + CELL_ALIGN);
+        array->elems = (char *)(((uintptr_t)array->slab + CELL_ALIGN - 1) &
+                                ~(uintptr_t)(CELL_ALIGN - 1));
+        return array;
+}
+
+/************* UArray2m_free ***************
+ * 
+ * Frees all the memory associated with the UArray2m passed in as a pointer.
+ *
+ * Parameters:
+ *      T *array2m: pointer to a UArray2m
+ * Returns:
+ *      None
+ * Expects:
+ *      The passed-in pointer and the UArray2m it points to are not NULL
+ *      (throws a CRE otherwise)
+ *
+ ********************************************/
+void UArray2m_free(T *array2m)
+{
+        assert(array2m != NULL && *array2m != NULL);
+        FREE((*array2m)->slab);
+        FREE(*array2m);
+}
+
+/************* UArray2m_width ***************
+ * 
+ * Returns the width of the given UArray2m
+ *
+ * Parameters:
+ *      T array2m: a UArray2m
+ * Returns:
+ *      integer representing the width of the passed-in UArray2m
+ * Expects:
+ *      The passed-in UArray2m is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+int UArray2m_width(T array2m)
+{
+        assert(array2m != NULL);
+        return array2m->width;
+}
+
+/************* UArray2m_height ***************
+ * 
+ * Returns the height of the given UArray2m
+ *
+ * Parameters:
+ *      T array2m: a UArray2m
+ * Returns:
+ *      integer representing the height of the passed-in UArray2m
+ * Expects:
+ *      The passed-in UArray2m is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+int UArray2m_height(T array2m)
+{
+        assert(array2m != NULL);
+        return array2m->height;
+}
+
+/************* UArray2m_size ***************
+ * 
+ * Returns the size of each cell of the given UArray2m
+ *
+ * Parameters:
+ *      T array2m: a UArray2m
+ * Returns:
+ *      integer of the size of each cell of the UArray2m
+ * Expects:
+ *      The passed-in UArray2m is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+int UArray2m_size(T array2m)
+{
+        assert(array2m != NULL);
+        return array2m->size;
+}
+
+/************* UArray2m_at ***************
+ * 
+ * Returns a void pointer to the element at the given indices for the given
+ * UArray2m
+ *
+ * Parameters:
+ *      T array2m:  a UArray2m from which we are retrieving the element
+ *      int column: the column index of the element
+ *      int row:    the row index of the element
+ * Returns:
+ *      a void pointer to the element in the UArray2m
+ * Expects:
+ *      The passed-in UArray2m is not NULL (throw CRE if NULL)
+ *      0 <= column < width and 0 <= row < height (throw CRE if not)
+ *
+ ********************************************/
+void *UArray2m_at(T array2m, int column, int row)
+{
+        assert(array2m != NULL);
+        assert((column >= 0) && (column < array2m->width));
+        assert((row >= 0) && (row < array2m->height));
+        int k = array2m->low_bits;
+        uint32_t mask = (1U << k) - 1;
+
+        /* only the longer dimension has bits above the low k */
+        uint64_t high = (uint32_t)(column >> k) + (uint32_t)(row >> k);
+        uint64_t index = (high << (2 * k)) |
+                         spread_bits(column & mask) |
+                         (spread_bits(row & mask) << 1);
+        return array2m->elems + index * array2m->size;
+}
+
+/* squares of at most this many bits a side are walked cell by cell */
+#define LEAF_BITS 3
+
+/************* map_square ***************
+ * 
+ * Applies a function to the cells of one Z-ordered square of the array,
+ * in storage order. A square wholly in the padding is skipped without
+ * visiting its cells, and a larger square is split into its four
+ * quadrants, which the Z-curve stores one after another. Only the small
+ * squares on the array's edge check their cells one by one.
+ *
+ * Parameters:
+ *      T array2m:  the array being mapped
+ *      int col:    column of the square's top-left cell
+ *      int row:    row of the square's top-left cell
+ *      int bits:   log2 of the square's side
+ *      char *p:    the square's first cell
+ *      void apply: the apply function executed on every element
+ *      void *cl:   closure passed through to apply
+ * Returns:
+ *      None
+ *
+ ********************************************/
+static void map_square(T array2m, int col, int row, int bits, char *p,
+                       void apply(int col, int row, T array2m, void *elem,
+                                  void *cl),
+                       void *cl)
+{
+        int w = array2m->width;
+        int h = array2m->height;
+        if (col >= w || row >= h) {
+                return;
+        }
+        int size = array2m->size;
+        if (bits <= LEAF_BITS) {
+                long cells = 1L << (2 * bits);
+                for (long index = 0; index < cells; index++, p += size) {
+                        int c = col + compact_bits(index);
+                        int r = row + compact_bits(index >> 1);
+                        if (c < w && r < h) {
+                                apply(c, r, array2m, p, cl);
+                        }
+                }
+                return;
+        }
+
+        int half = 1 << (bits - 1);
+        long quarter = (1L << (2 * (bits - 1))) * size;
+        map_square(array2m, col, row, bits - 1, p, apply, cl);
+        map_square(array2m, col + half, row, bits - 1, p + quarter, apply,
+                   cl);
+        map_square(array2m, col, row + half, bits - 1, p + 2 * quarter,
+                   apply, cl);
+        map_square(array2m, col + half, row + half, bits - 1,
+                   p + 3 * quarter, apply, cl);
+}
+
+/************* UArray2m_map ***************
+ * 
+ * Mapping function which parses through the given array2m in the order the
+ * cells are stored (along the Z-curve), executing the apply function on each
+ * element. The array is a strip of Z-ordered squares, each walked by
+ * map_square, so runs of padding cells outside the array are skipped a
+ * square at a time rather than decoded and tested one by one.
+ *
+ * Parameters:
+ *      T array2m:  a UArray2m that is being mapped through
+ *      void apply: the apply function executed on every element
+ *      void *cl:   closure passed through to apply
+ * Returns:
+ *      None
+ * Expects:
+ *      The passed-in UArray2m is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+void UArray2m_map(T array2m, void apply(int col, int row, T array2m,
+                                        void *elem, void *cl), void *cl)
+{
+        assert(array2m != NULL);
+        int k = array2m->low_bits;
+        long square_bytes = (1L << (2 * k)) * array2m->size;
+        long nsquares = array2m->cells >> (2 * k);
+        char *p = array2m->elems;
+
+        /* the squares run along the longer dimension */
+        for (long s = 0; s < nsquares; s++, p += square_bytes) {
+                int along = (int)(s << k);
+                if (array2m->wide) {
+                        map_square(array2m, along, 0, k, p, apply, cl);
+                } else {
+                        map_square(array2m, 0, along, k, p, apply, cl);
+                }
+        }
+}
+
+/********** hilbert_closure ********
+ * 
+ * Closure for visit_cell: the array being mapped and the caller's apply
+ * function and closure.
+ *
+ *******************/
+struct hilbert_closure {
+        T array2m;
+        void (*apply)(int col, int row, T array2m, void *elem, void *cl);
+        void *cl;
+};
+
+/************* visit_cell ***************
+ * 
+ * Hilbert_map visit function that applies the caller's function to the
+ * cell at (col, row).
+ *
+ ********************************************/
+static void visit_cell(int col, int row, void *vcl)
+{
+        struct hilbert_closure *hcl = vcl;
+        hcl->apply(col, row, hcl->array2m,
+                   UArray2m_at(hcl->array2m, col, row), hcl->cl);
+}
+
+/************* UArray2m_map_hilbert ***************
+ * 
+ * Mapping function which visits every cell of the given array2m along a
+ * Hilbert curve, executing the apply function on each element.
+ *
+ * Parameters:
+ *      T array2m:  a UArray2m that is being mapped through
+ *      void apply: the apply function executed on every element
+ *      void *cl:   closure passed through to apply
+ * Returns:
+ *      None
+ * Expects:
+ *      The passed-in UArray2m is not NULL (throw CRE if NULL)
+ *
+ ********************************************/
+void UArray2m_map_hilbert(T array2m, void apply(int col, int row, T array2m,
+                                                void *elem, void *cl),
+                          void *cl)
+{
+        assert(array2m != NULL);
+        struct hilbert_closure hcl = { array2m, apply, cl };
+        Hilbert_map(array2m->width, array2m->height, visit_cell, &hcl);
+}
@@ -0,0 +1,27 @@
+#ifndef UARRAY2M_INCLUDED
+#define UARRAY2M_INCLUDED
+
+#define T UArray2m_T
+typedef struct T *T;
+
+extern T     UArray2m_new   (int width, int height, int size);
+  /* new 2d array whose cells are stored in Morton (Z-order) */
+extern void  UArray2m_free  (T *array2m);
+extern int   UArray2m_width (T array2m);
+extern int   UArray2m_height(T array2m);
+extern int   UArray2m_size  (T array2m);
+extern void *UArray2m_at    (T array2m, int column, int row);
+  /* return a pointer to the cell in the given column and row.
+     index out of range is a checked run-time error */
+extern void  UArray2m_map   (T array2m,
+    void apply(int col, int row, T array2m, void *elem, void *cl), void *cl);
+  /* visits every cell in storage (Z-curve) order */
+extern void  UArray2m_map_hilbert(T array2m,
+    void apply(int col, int row, T array2m, void *elem, void *cl), void *cl);
+  /* visits every cell in Hilbert-curve order */
+
+/* it is a checked run-time error to pass a NULL T
+   to any function in this interface */
+
+#undef T
+#endif
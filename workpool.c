@@ -0,0 +1,442 @@
+/**************************************************************
+ *
+ *                     workpool.c
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: This file implements Workpool_T. Tasks are numbered, and a
+ *              job hands each worker a contiguous range of task numbers as
+ *              its deque. The owner works forward from the front of its
+ *              range, which keeps it moving through the source in storage
+ *              order. A thief takes from the back of a random victim's
+ *              range, far from where the owner is working. Taking from
+ *              either end leaves the range contiguous, so a deque is just
+ *              two indices under a mutex. Tasks do not submit tasks, so
+ *              once a worker has found every deque empty, no work can
+ *              appear later, and it leaves the job.
+ *              
+ **************************************************************/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "mem.h"
+#include "workpool.h"
+
+#define T Workpool_T
+
+/* random victims tried before sweeping every deque in turn */
+#define STEAL_TRIES 4
+
+/********** deque ********
+ * 
+ * The task numbers [front, back) not yet taken from one worker's share of
+ * the current job. Padded to a cache line so that workers taking tasks
+ * from their own deques do not slow each other down.
+ *
+ *******************/
+struct deque {
+        pthread_mutex_t lock;
+        int front, back;
+        char pad[64];
+};
+
+/********** worker ********
+ * 
+ * A worker's thread, its index in the pool and its random-number state
+ * for choosing victims.
+ *
+ *******************/
+struct worker {
+        T pool;
+        int index;
+        unsigned seed;
+        pthread_t thread;
+};
+
+/********** T ********
+ * 
+ * Struct for the pool. The current job is the task function, its closure
+ * and the number of tasks; generation counts jobs, so sleeping workers can
+ * tell a new one has been posted. active counts the started threads still
+ * working on the current job.
+ *
+ *******************/
+struct T {
+        int nworkers;
+        struct deque *deques;   /* one per worker; worker 0 is the caller */
+        struct worker *workers;
+
+        pthread_mutex_t run_lock; /* one job at a time */
+        pthread_mutex_t lock;     /* guards everything below */
+        pthread_cond_t posted;    /* a job was posted, or shutdown */
+        pthread_cond_t finished;  /* active dropped to 0 */
+        unsigned long generation;
+        int active;
+        bool shutdown;
+
+        Workpool_taskfun *task;
+        void *cl;
+};
+
+/****************** take_own *******************
+ * 
+ * Takes the task at the front of a worker's own deque.
+ *
+ * Parameters:
+ *      struct deque *d: the worker's deque
+ *      int *i:          set to the task number taken
+ * Returns:
+ *      true if a task was taken, false if the deque was empty
+ * Expects:
+ *      d and i are not NULL
+ *
+ ********************************************/
+static bool take_own(struct deque *d, int *i)
+{
+        bool found = false;
+        pthread_mutex_lock(&d->lock);
+        if (d->front < d->back) {
+                *i = d->front++;
+                found = true;
+        }
+        pthread_mutex_unlock(&d->lock);
+        return found;
+}
+
+/****************** steal *******************
+ * 
+ * Takes the task at the back of another worker's deque.
+ *
+ * Parameters:
+ *      struct deque *d: the victim's deque
+ *      int *i:          set to the task number taken
+ * Returns:
+ *      true if a task was taken, false if the deque was empty
+ * Expects:
+ *      d and i are not NULL
+ *
+ ********************************************/
+static bool steal(struct deque *d, int *i)
+{
+        bool found = false;
+        pthread_mutex_lock(&d->lock);
+        if (d->front < d->back) {
+                *i = --d->back;
+                found = true;
+        }
+        pthread_mutex_unlock(&d->lock);
+        return found;
+}
+
+/****************** find_task *******************
+ * 
+ * Finds the next task for a worker: from its own deque if it can, else
+ * by stealing, first from a few random victims and then from each of
+ * the others in turn.
+ *
+ * Parameters:
+ *      struct worker *w: the worker looking for work
+ *      int *i:           set to the task number found
+ * Returns:
+ *      true if a task was found, false if every deque is empty
+ * Expects:
+ *      w and i are not NULL
+ *
+ ********************************************/
+static bool find_task(struct worker *w, int *i)
+{
+        T pool = w->pool;
+        int n = pool->nworkers;
+        if (take_own(&pool->deques[w->index], i)) {
+                return true;
+        }
+        for (int k = 0; k < STEAL_TRIES && n > 1; k++) {
+                int victim = rand_r(&w->seed) % n;
+                if (victim != w->index && steal(&pool->deques[victim], i)) {
+                        return true;
+                }
+        }
+        for (int k = 1; k < n; k++) {
+                if (steal(&pool->deques[(w->index + k) % n], i)) {
+                        return true;
+                }
+        }
+        return false;
+}
+
+/****************** work *******************
+ * 
+ * Runs tasks of the current job until none are left to find.
+ *
+ * Parameters:
+ *      struct worker *w: the worker doing the work
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      w is not NULL and a job has been posted
+ *
+ ********************************************/
+static void work(struct worker *w)
+{
+        T pool = w->pool;
+        int i;
+        while (find_task(w, &i)) {
+                pool->task(i, pool->cl);
+        }
+}
+
+/****************** thread_main *******************
+ * 
+ * Body of each started thread: waits for a job to be posted, works on it,
+ * reports that it is done, and waits again, until the pool is freed.
+ *
+ * Parameters:
+ *      void *cl: the thread's struct worker
+ * Returns:
+ *      NULL
+ * Expects:
+ *      cl is not NULL
+ *
+ ********************************************/
+static void *thread_main(void *cl)
+{
+        struct worker *w = cl;
+        T pool = w->pool;
+        unsigned long seen = 0;
+
+        pthread_mutex_lock(&pool->lock);
+        for (;;) {
+                while (!pool->shutdown && pool->generation == seen) {
+                        pthread_cond_wait(&pool->posted, &pool->lock);
+                }
+                if (pool->shutdown) {
+                        break;
+                }
+                seen = pool->generation;
+                pthread_mutex_unlock(&pool->lock);
+
+                work(w);
+
+                pthread_mutex_lock(&pool->lock);
+                if (--pool->active == 0) {
+                        pthread_cond_signal(&pool->finished);
+                }
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+}
+
+/****************** Workpool_new *******************
+ * 
+ * Makes a pool of nworkers workers and starts nworkers - 1 threads; the
+ * thread that calls Workpool_run is the remaining worker.
+ *
+ * Parameters:
+ *      int nworkers: number of workers
+ * Returns:
+ *      the new pool
+ * Expects:
+ *      nworkers is positive and the threads can be started (throws a CRE
+ *      otherwise)
+ *
+ ********************************************/
+T Workpool_new(int nworkers)
+{
+        assert(nworkers > 0);
+        T pool;
+        NEW(pool);
+        pool->nworkers = nworkers;
+        pool->deques = CALLOC(nworkers, sizeof(*pool->deques));
+        pool->workers = CALLOC(nworkers, sizeof(*pool->workers));
+        pthread_mutex_init(&pool->run_lock, NULL);
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->posted, NULL);
+        pthread_cond_init(&pool->finished, NULL);
+        pool->generation = 0;
+        pool->active = 0;
+        pool->shutdown = false;
+        pool->task = NULL;
+        pool->cl = NULL;
+
+        for (int k = 0; k < nworkers; k++) {
+                pthread_mutex_init(&pool->deques[k].lock, NULL);
+                pool->workers[k].pool = pool;
+                pool->workers[k].index = k;
+                pool->workers[k].seed = 2654435761u * (k + 1);
+        }
+        for (int k = 1; k < nworkers; k++) {
+                int err = pthread_create(&pool->workers[k].thread, NULL,
+                                         thread_main, &pool->workers[k]);
+                assert(err == 0);
+        }
+        return pool;
+}
+
+/****************** Workpool_free *******************
+ * 
+ * Stops and joins the pool's threads and deallocates the pool.
+ *
+ * Parameters:
+ *      T *pool: pointer to the pool
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      pool and *pool are not NULL (throws a CRE if NULL), and no job is
+ *      running
+ *
+ ********************************************/
+void Workpool_free(T *pool)
+{
+        assert(pool != NULL && *pool != NULL);
+        T p = *pool;
+        pthread_mutex_lock(&p->lock);
+        p->shutdown = true;
+        pthread_cond_broadcast(&p->posted);
+        pthread_mutex_unlock(&p->lock);
+        for (int k = 1; k < p->nworkers; k++) {
+                pthread_join(p->workers[k].thread, NULL);
+        }
+        for (int k = 0; k < p->nworkers; k++) {
+                pthread_mutex_destroy(&p->deques[k].lock);
+        }
+        pthread_cond_destroy(&p->finished);
+        pthread_cond_destroy(&p->posted);
+        pthread_mutex_destroy(&p->lock);
+        pthread_mutex_destroy(&p->run_lock);
+        FREE(p->workers);
+        FREE(p->deques);
+        FREE(*pool);
+}
+
+/****************** Workpool_size *******************
+ * 
+ * Returns the number of workers in the pool, the caller's included.
+ *
+ * Parameters:
+ *      T pool: the pool
+ * Returns:
+ *      the number of workers
+ * Expects:
+ *      pool is not NULL (throws a CRE if NULL)
+ *
+ ********************************************/
+int Workpool_size(T pool)
+{
+        assert(pool != NULL);
+        return pool->nworkers;
+}
+
+/****************** Workpool_run *******************
+ * 
+ * Runs task(i, cl) for i = 0 .. ntasks - 1. The task numbers are dealt
+ * out as equal contiguous ranges, one per worker, and the calling thread
+ * works as worker 0. Returns once every task has finished.
+ *
+ * Parameters:
+ *      T pool:                 the pool
+ *      int ntasks:             number of tasks
+ *      Workpool_taskfun *task: the work of one task
+ *      void *cl:               closure passed to every task
+ * Returns:
+ *      Nothing
+ * Expects:
+ *      pool and task are not NULL and ntasks is not negative (throws a CRE
+ *      otherwise). task must not call Workpool_run on the same pool.
+ *
+ ********************************************/
+void Workpool_run(T pool, int ntasks, Workpool_taskfun *task, void *cl)
+{
+        assert(pool != NULL && task != NULL && ntasks >= 0);
+        int n = pool->nworkers;
+
+        pthread_mutex_lock(&pool->run_lock);
+        for (int k = 0; k < n; k++) {
+                struct deque *d = &pool->deques[k];
+                pthread_mutex_lock(&d->lock);
+                d->front = (int)((long)ntasks * k / n);
+                d->back = (int)((long)ntasks * (k + 1) / n);
+                pthread_mutex_unlock(&d->lock);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        pool->task = task;
+        pool->cl = cl;
+        pool->active = n - 1;
+        pool->generation++;
+        pthread_cond_broadcast(&pool->posted);
+        pthread_mutex_unlock(&pool->lock);
+
+        work(&pool->workers[0]);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->active > 0) {
+                pthread_cond_wait(&pool->finished, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        pthread_mutex_unlock(&pool->run_lock);
+}
+
+/* the shared pools, one for each size asked for, in the order made */
+static T *shared = NULL;
+static int nshared = 0;
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/****************** free_shared *******************
+ * 
+ * Frees the shared pools at exit, so that their threads are joined and
+ * no memory is left allocated.
+ *
+ ********************************************/
+static void free_shared(void)
+{
+        for (int k = 0; k < nshared; k++) {
+                Workpool_free(&shared[k]);
+        }
+        FREE(shared);
+        nshared = 0;
+}
+
+/****************** Workpool_shared *******************
+ * 
+ * Returns the process-wide pool of the given size, making it on first
+ * use. A pool is kept for later calls, and freed when the program exits.
+ * A pool of another size is a separate pool: it is never freed while the
+ * program runs, since a thread elsewhere may hold it or be running a job
+ * on it, and nothing but its own run_lock would tell.
+ *
+ * Parameters:
+ *      int nworkers: number of workers wanted
+ * Returns:
+ *      a pool of nworkers workers
+ * Expects:
+ *      nworkers is positive (throws a CRE otherwise)
+ *
+ ********************************************/
+T Workpool_shared(int nworkers)
+{
+        assert(nworkers > 0);
+        pthread_mutex_lock(&shared_lock);
+        T pool = NULL;
+        for (int k = 0; k < nshared && pool == NULL; k++) {
+                if (shared[k]->nworkers == nworkers) {
+                        pool = shared[k];
+                }
+        }
+        if (pool == NULL) {
+                if (nshared == 0) {
+                        atexit(free_shared);
+                }
+                RESIZE(shared, (long)(nshared + 1) * sizeof *shared);
+                pool = Workpool_new(nworkers);
+                shared[nshared++] = pool;
+        }
+        pthread_mutex_unlock(&shared_lock);
+        return pool;
+}
+
+#undef T
@@ -0,0 +1,46 @@
+/**************************************************************
+ *
+ *                     workpool.h
+ *
+ *     Assignment: HW 3: locality
+ *        Authors: Dan Glorioso & Brandon Dionisio (dglori02 & bdioni01)
+ *           Date: 02/22/24
+ *
+ *     Summary: Interface for Workpool_T, a pool of worker threads with a
+ *              work-stealing scheduler. A job is a numbered set of tasks.
+ *              Each worker starts with its own deque of tasks, and a worker
+ *              whose deque runs dry steals from a randomly chosen other
+ *              worker. So partial edge tiles, filters of uneven cost and
+ *              preempted cores do not leave the others idle. The threads
+ *              are created once and reused by every job.
+ *              
+ **************************************************************/
+
+#ifndef WORKPOOL_INCLUDED
+#define WORKPOOL_INCLUDED
+
+#define T Workpool_T
+typedef struct T *T;
+
+/* the work of task number i of a job */
+typedef void Workpool_taskfun(int i, void *cl);
+
+/* a pool of nworkers workers: the thread calling Workpool_run is one of
+   them, so nworkers - 1 threads are started */
+extern T    Workpool_new (int nworkers);
+extern void Workpool_free(T *pool);
+extern int  Workpool_size(T pool);
+
+/* runs task(i, cl) for every i in [0, ntasks) on the workers of pool and
+   returns when all have finished. Jobs from different threads take turns */
+extern void Workpool_run(T pool, int ntasks, Workpool_taskfun *task,
+                         void *cl);
+
+/* a process-wide pool of nworkers workers, made on first use and kept
+   for later calls, so batch runs pay for thread creation once. Each size
+   asked for has its own pool, and none is freed before the program exits,
+   so a pool stays valid while another thread asks for a different size */
+extern T    Workpool_shared(int nworkers);
+
+#undef T
+#endif
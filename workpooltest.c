@@ -0,0 +1,144 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "workpool.h"
+
+/* more workers than this machine is likely to have cores, so that tasks
+   are stolen from preempted workers too */
+#define MANY 8
+
+/* task counts: none, fewer than the workers, and more, not multiples of
+   any worker count */
+static const int ntasks[] = { 0, 1, 2, 3, 7, 100, 1001 };
+#define NNTASKS ((int)(sizeof(ntasks) / sizeof(ntasks[0])))
+
+/* a job whose tasks count their own visits */
+struct job {
+        int *visits;
+        int ntasks;
+};
+
+/* task i does work that grows with i, so the workers' shares are uneven,
+   then records its visit */
+static void visit(int i, void *cl)
+{
+        struct job *job = cl;
+        assert(0 <= i && i < job->ntasks);
+        volatile unsigned spin = 0;
+        for (int k = 0; k < (i % 13) * 2000; k++) {
+                spin += k;
+        }
+        __atomic_fetch_add(&job->visits[i], 1, __ATOMIC_RELAXED);
+}
+
+/* runs a job of n tasks on the pool and checks that every task ran
+   exactly once */
+static void run_and_check(Workpool_T pool, int n)
+{
+        struct job job;
+        job.ntasks = n;
+        job.visits = CALLOC(n > 0 ? n : 1, sizeof *job.visits);
+        Workpool_run(pool, n, visit, &job);
+        for (int i = 0; i < n; i++) {
+                assert(job.visits[i] == 1);
+        }
+        FREE(job.visits);
+}
+
+/* a pool of each size runs jobs of every size, one after another */
+static void test_sizes(void)
+{
+        static const int workers[] = { 1, 2, MANY };
+        for (int w = 0; w < 3; w++) {
+                Workpool_T pool = Workpool_new(workers[w]);
+                assert(Workpool_size(pool) == workers[w]);
+                for (int k = 0; k < NNTASKS; k++) {
+                        run_and_check(pool, ntasks[k]);
+                }
+                Workpool_free(&pool);
+                assert(pool == NULL);
+        }
+}
+
+/* the shared pool is kept across back-to-back jobs of the same size, and
+   a different size gets a pool of its own, leaving the first one valid */
+static void test_shared(void)
+{
+        Workpool_T pool = Workpool_shared(MANY);
+        for (int round = 0; round < 50; round++) {
+                assert(Workpool_shared(MANY) == pool);
+                run_and_check(Workpool_shared(MANY),
+                              ntasks[round % NNTASKS]);
+        }
+        Workpool_T other = Workpool_shared(2);
+        assert(other != pool && Workpool_size(other) == 2);
+        for (int k = 0; k < NNTASKS; k++) {
+                run_and_check(Workpool_shared(2), ntasks[k]);
+        }
+        assert(Workpool_shared(MANY) == pool);
+        run_and_check(pool, 1001);
+}
+
+/* runs jobs on the shared pool of the size cl points to */
+static void *submit_sized(void *cl)
+{
+        int nworkers = *(int *)cl;
+        for (int round = 0; round < 20; round++) {
+                run_and_check(Workpool_shared(nworkers), 1001);
+        }
+        return NULL;
+}
+
+static void *submit(void *cl)
+{
+        (void)cl;
+        for (int round = 0; round < 20; round++) {
+                run_and_check(Workpool_shared(MANY), 1001);
+        }
+        return NULL;
+}
+
+/* jobs submitted from several threads at once take turns on the shared
+   pool, and each still runs every task once */
+static void test_concurrent(void)
+{
+        Workpool_shared(MANY);
+        pthread_t threads[3];
+        for (int k = 0; k < 3; k++) {
+                int err = pthread_create(&threads[k], NULL, submit, NULL);
+                assert(err == 0);
+        }
+        for (int k = 0; k < 3; k++) {
+                pthread_join(threads[k], NULL);
+        }
+}
+
+/* jobs of several threads, each asking for its own size of shared pool,
+   run at once without a pool being freed under another thread */
+static void test_mixed_sizes(void)
+{
+        static int sizes[] = { 1, 2, 3, MANY };
+        pthread_t threads[4];
+        for (int k = 0; k < 4; k++) {
+                int err = pthread_create(&threads[k], NULL, submit_sized,
+                                         &sizes[k]);
+                assert(err == 0);
+        }
+        for (int k = 0; k < 4; k++) {
+                pthread_join(threads[k], NULL);
+        }
+}
+
+int main(int argc, char *argv[])
+{
+        assert(argc == 1);
+        (void)argv;
+        test_sizes();
+        test_shared();
+        test_concurrent();
+        test_mixed_sizes();
+        printf("Passed.\n");
+        return 0;
+}